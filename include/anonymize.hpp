@@ -0,0 +1,207 @@
+#ifndef ANONYMIZE_HPP
+#define ANONYMIZE_HPP
+
+// Hashing of names and paths for --lcom:anonymous.
+// std::hash differs between standard libraries and is not required to be
+// stable between runs, so anonymized results could not be joined across
+// builds or machines. Names are instead hashed with XXH64, which is fixed,
+// fast and reads its input byte by byte, so the hashes do not depend on the
+// host either. XXH64 is not keyed, though: anyone can hash guessed names, and
+// even a seed can be recovered from a single known name and its hash. With
+// --lcom:anonymous-key, names are therefore hashed with SipHash-2-4, a keyed
+// hash, so every run sharing the key produces the same IDs while guesses
+// cannot be checked without the key.
+// This header does not depend on ROSE.
+
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace Anonymize {
+
+// The key set by --lcom:anonymous-key. Applied with SetKey().
+std::string key;
+// The SipHash key derived from key. Only used if key is set.
+std::uint64_t sipKey[2] = {0, 0};
+
+namespace detail {
+
+constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t P3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t Rotl(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian reads, independent of the host byte order.
+inline std::uint64_t Read64(const unsigned char* p) {
+  std::uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+inline std::uint64_t Read32(const unsigned char* p) {
+  std::uint64_t v = 0;
+  for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+inline std::uint64_t Round(std::uint64_t acc, std::uint64_t input) {
+  acc += input * P2;
+  return Rotl(acc, 31) * P1;
+}
+
+inline std::uint64_t Merge(std::uint64_t acc, std::uint64_t val) {
+  acc ^= Round(0, val);
+  return acc * P1 + P4;
+}
+
+inline void SipRound(std::uint64_t& v0, std::uint64_t& v1, std::uint64_t& v2,
+                     std::uint64_t& v3) {
+  v0 += v1;
+  v1 = Rotl(v1, 13);
+  v1 ^= v0;
+  v0 = Rotl(v0, 32);
+  v2 += v3;
+  v3 = Rotl(v3, 16);
+  v3 ^= v2;
+  v0 += v3;
+  v3 = Rotl(v3, 21);
+  v3 ^= v0;
+  v2 += v1;
+  v1 = Rotl(v1, 17);
+  v1 ^= v2;
+  v2 = Rotl(v2, 32);
+}
+
+}  // namespace detail
+
+// The 64-bit xxHash (XXH64) of len bytes at data.
+std::uint64_t XXH64(const void* data, std::size_t len, std::uint64_t seed) {
+  using namespace detail;
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = p + len;
+  std::uint64_t h;
+
+  if (len >= 32) {
+    std::uint64_t v1 = seed + P1 + P2;
+    std::uint64_t v2 = seed + P2;
+    std::uint64_t v3 = seed;
+    std::uint64_t v4 = seed - P1;
+    const unsigned char* const limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = Merge(h, v1);
+    h = Merge(h, v2);
+    h = Merge(h, v3);
+    h = Merge(h, v4);
+  } else {
+    h = seed + P5;
+  }
+  h += len;
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * P1 + P4;
+  }
+  if (p + 4 <= end) {
+    h ^= Read32(p) * P1;
+    h = Rotl(h, 23) * P2 + P3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= *p * P5;
+    h = Rotl(h, 11) * P1;
+  }
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+// The 64-bit SipHash-2-4 of len bytes at data, under the key (k0, k1).
+std::uint64_t SipHash24(const void* data, std::size_t len, std::uint64_t k0,
+                        std::uint64_t k1) {
+  using namespace detail;
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* const end = p + len;
+  std::uint64_t v0 = k0 ^ 0x736F6D6570736575ULL;
+  std::uint64_t v1 = k1 ^ 0x646F72616E646F6DULL;
+  std::uint64_t v2 = k0 ^ 0x6C7967656E657261ULL;
+  std::uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+  for (; p + 8 <= end; p += 8) {
+    const std::uint64_t m = Read64(p);
+    v3 ^= m;
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+  // The last block holds the remaining bytes and the length in its top byte.
+  std::uint64_t b = static_cast<std::uint64_t>(len) << 56;
+  for (int i = 0; p + i < end; i++) b |= std::uint64_t(p[i]) << (8 * i);
+  v3 ^= b;
+  SipRound(v0, v1, v2, v3);
+  SipRound(v0, v1, v2, v3);
+  v0 ^= b;
+
+  v2 ^= 0xFF;
+  for (int i = 0; i < 4; i++) SipRound(v0, v1, v2, v3);
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+namespace detail {
+// Anonymized path components, which depend on the key.
+std::unordered_map<std::string, std::string> components;
+}  // namespace detail
+
+// Set the key of every hash. An empty key restores unkeyed XXH64.
+// The 128-bit SipHash key is spread from the key with XXH64, so the IDs are
+// only as hard to reverse as the key is to guess.
+void SetKey(const std::string& k) {
+  key = k;
+  sipKey[0] = XXH64(key.data(), key.size(), 0);
+  sipKey[1] = XXH64(key.data(), key.size(), detail::P1);
+  detail::components.clear();
+}
+
+// The anonymized form of a name.
+std::string Hash(const std::string& s) {
+  if (key.empty()) return std::to_string(XXH64(s.data(), s.size(), 0));
+  return std::to_string(SipHash24(s.data(), s.size(), sipKey[0], sipKey[1]));
+}
+
+// The anonymized form of a path, hashing each component separately.
+// Components are cached, as the files of a project share most of their
+// directories. SetKey() empties the cache.
+// NOTE: The cache is not synchronized, so paths must be anonymized from a
+// single thread.
+boost::filesystem::path Path(const boost::filesystem::path& path) {
+  std::unordered_map<std::string, std::string>& components =
+      detail::components;
+  boost::filesystem::path anonymized;
+  for (const auto& part : path) {
+    const std::string& s = part.string();
+    auto it = components.find(s);
+    if (it == components.end()) it = components.emplace(s, Hash(s)).first;
+    anonymized /= it->second;
+  }
+  return anonymized;
+}
+
+}  // namespace Anonymize
+
+#endif  // ANONYMIZE_HPP
@@ -0,0 +1,327 @@
+#ifndef ASYNCLOG_HPP
+#define ASYNCLOG_HPP
+
+// Asynchronous log sink.
+// Each thread formats its messages into its own lock-free ring buffer, and a
+// background thread drains the rings into large writes to standard output or
+// to --lcom:log-file. Logging therefore never waits on I/O, which makes
+// trace-level runs practical on large inputs.
+// Memory is bounded: a message that does not fit into its thread's ring is
+// dropped and counted, and the count is reported at the next flush and at the
+// end of the log.
+// Program output written to std::cout shares standard output with the log, so
+// it must be written between calls to Sync() to keep both in order.
+// Messages still buffered when the process crashes are lost, except for fatal
+// messages, which are flushed before asserting.
+// This header does not depend on ROSE.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "aixlog.hpp"
+
+namespace AsyncLog {
+
+// Where to write log messages. Standard output is used while this is empty.
+std::string outputPath;
+
+// Bytes of messages each thread may have waiting to be written. Must be a
+// power of two.
+constexpr std::size_t ringBytes = std::size_t(1) << 22;
+// Drained messages are collected until this many bytes are pending, or until
+// there is nothing left to drain, before they are written out.
+constexpr std::size_t writeBytes = std::size_t(1) << 20;
+
+// A single-producer, single-consumer ring of bytes.
+// Only the owning thread pushes, and only the drainer pops. A message is
+// published by advancing head after it has been copied in completely, so the
+// drainer never sees part of a message.
+class Ring {
+  std::vector<char> data;
+  // Total bytes ever pushed and popped. Positions are masked into data.
+  std::atomic<std::size_t> head{0};
+  std::atomic<std::size_t> tail{0};
+
+ public:
+  Ring* next = nullptr;
+
+  Ring() : data(ringBytes) {}
+
+  // Push the concatenation of pieces as one message. Returns false, leaving
+  // the ring unchanged, if the message does not fit.
+  bool Push(
+      std::initializer_list<std::pair<const char*, std::size_t>> pieces) {
+    std::size_t size = 0;
+    for (const auto& piece : pieces) size += piece.second;
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    const std::size_t t = tail.load(std::memory_order_acquire);
+    if (size > data.size() - (h - t)) return false;
+    std::size_t pos = h;
+    for (const auto& piece : pieces) {
+      const std::size_t offset = pos & (data.size() - 1);
+      const std::size_t first = std::min(piece.second, data.size() - offset);
+      std::memcpy(&data[offset], piece.first, first);
+      std::memcpy(&data[0], piece.first + first, piece.second - first);
+      pos += piece.second;
+    }
+    head.store(h + size, std::memory_order_release);
+    return true;
+  }
+
+  // Whether any published bytes are waiting to be popped.
+  bool Pending() const {
+    return head.load(std::memory_order_acquire) !=
+           tail.load(std::memory_order_relaxed);
+  }
+
+  // Move every published byte to the end of out. Returns whether there were
+  // any.
+  bool Pop(std::string& out) {
+    const std::size_t t = tail.load(std::memory_order_relaxed);
+    const std::size_t h = head.load(std::memory_order_acquire);
+    if (h == t) return false;
+    const std::size_t pos = t & (data.size() - 1);
+    const std::size_t first = std::min(h - t, data.size() - pos);
+    out.append(&data[pos], first);
+    out.append(&data[0], h - t - first);
+    tail.store(h, std::memory_order_release);
+    return true;
+  }
+};
+
+class Sink : public AixLog::Sink {
+  // Distinguishes sinks, so threads do not reuse a ring from an earlier one.
+  static std::atomic<std::uint64_t> nextId;
+  const std::uint64_t id = nextId++;
+
+  int fd = STDOUT_FILENO;
+  // Rings of every thread that has logged, linked with a compare-and-swap.
+  std::atomic<Ring*> rings{nullptr};
+  std::atomic<std::uint64_t> dropped{0};
+  // Dropped messages already reported. Only used by the drainer.
+  std::uint64_t droppedReported = 0;
+  // Messages pushed, and the pushed and dropped messages covered by the last
+  // completed flush, so that flushing is free while nothing is logged.
+  std::atomic<std::uint64_t> logged{0};
+  std::atomic<std::uint64_t> flushedCount{0};
+
+  // Flush requests and the drainer's progress through them.
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable flushed;
+  std::atomic<std::uint64_t> flushRequests{0};
+  std::uint64_t flushesDone = 0;
+  std::atomic<bool> stopping{false};
+  // Set while the drainer waits for messages, so producers know to wake it.
+  std::atomic<bool> sleeping{false};
+
+  std::thread drainer;
+
+  // Get the calling thread's ring, creating and registering it if needed.
+  Ring& ThreadRing() {
+    thread_local Ring* ring = nullptr;
+    thread_local std::uint64_t ringOwner = 0;
+    if (ring == nullptr || ringOwner != id) {
+      ring = new Ring();
+      ringOwner = id;
+      ring->next = rings.load(std::memory_order_relaxed);
+      while (!rings.compare_exchange_weak(ring->next, ring,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+      }
+    }
+    return *ring;
+  }
+
+  bool AnyPending() {
+    for (Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+         ring = ring->next) {
+      if (ring->Pending()) return true;
+    }
+    return false;
+  }
+
+  // Wake the drainer if it is waiting for messages. Taking the mutex ensures
+  // the drainer is either still before its final check for messages or
+  // already blocked, so the notification cannot be lost.
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!sleeping.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    wake.notify_one();
+  }
+
+  // Append a warning about messages dropped since the last report.
+  void ReportDropped(std::string& pending) {
+    const std::uint64_t count = dropped.load();
+    if (count == droppedReported) return;
+    pending += "[" + AixLog::to_string(AixLog::Severity::warning) + "] " +
+               std::to_string(count - droppedReported) +
+               " log messages were dropped because the log buffer was "
+               "full.\n";
+    droppedReported = count;
+  }
+
+  void Write(std::string& pending) {
+    const char* p = pending.data();
+    std::size_t left = pending.size();
+    while (left > 0) {
+      const ssize_t n = ::write(fd, p, left);
+      if (n < 0 && errno == EINTR) continue;
+      // Nowhere left to report the failure, so drop the rest.
+      if (n <= 0) break;
+      p += n;
+      left -= static_cast<std::size_t>(n);
+    }
+    pending.clear();
+  }
+
+  void Run() {
+    std::string pending;
+    pending.reserve(writeBytes + ringBytes);
+    while (true) {
+      // Read these first, so the pass below covers every message logged
+      // before a flush was requested or the sink started stopping.
+      const bool stop = stopping.load(std::memory_order_acquire);
+      const std::uint64_t request =
+          flushRequests.load(std::memory_order_acquire);
+      bool any = false;
+      for (Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+           ring = ring->next) {
+        any = ring->Pop(pending) || any;
+      }
+      if (stop || request != flushesDone) ReportDropped(pending);
+      if (!any || pending.size() >= writeBytes || request != flushesDone) {
+        Write(pending);
+      }
+      if (request != flushesDone) {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushesDone = request;
+        flushed.notify_all();
+      }
+      if (stop) break;
+      if (!any) {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake.wait(lock, [&]() {
+          return stopping.load() || flushRequests.load() != request ||
+                 AnyPending();
+        });
+        sleeping.store(false, std::memory_order_relaxed);
+      }
+    }
+  }
+
+ public:
+  Sink(const AixLog::Filter& filter) : AixLog::Sink(filter) {
+    if (!outputPath.empty()) {
+      fd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+      if (fd < 0) {
+        // The logger is not set up yet, so report this directly.
+        std::cerr << "Unable to open " << outputPath
+                  << " for logging. Logging to standard output." << std::endl;
+        fd = STDOUT_FILENO;
+      }
+    }
+    drainer = std::thread(&Sink::Run, this);
+    current = this;
+  }
+
+  ~Sink() override {
+    current = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping.store(true, std::memory_order_release);
+    }
+    wake.notify_all();
+    // The drainer reports any remaining dropped messages before it stops.
+    drainer.join();
+    if (fd != STDOUT_FILENO) ::close(fd);
+    for (Ring* ring = rings.load(); ring != nullptr;) {
+      Ring* next = ring->next;
+      delete ring;
+      ring = next;
+    }
+  }
+
+  void log(const AixLog::Metadata& metadata,
+           const std::string& message) override {
+    // Copy the pieces straight into the ring rather than formatting the line
+    // separately first.
+    const std::string severity = AixLog::to_string(metadata.severity);
+    std::string location;
+    if (metadata.severity >= AixLog::Severity::warning) {
+      location = " [" + metadata.function.file + ":" +
+                 std::to_string(metadata.function.line) + "]";
+    }
+    const bool pushed = ThreadRing().Push({{"[", 1},
+                                           {severity.data(), severity.size()},
+                                           {"] ", 2},
+                                           {message.data(), message.size()},
+                                           {location.data(), location.size()},
+                                           {"\n", 1}});
+    if (pushed) {
+      logged++;
+      Notify();
+    } else {
+      dropped++;
+    }
+    if (metadata.severity >= AixLog::Severity::fatal) {
+      Flush();
+      assert(false);
+    }
+  }
+
+  // Block until every message logged so far has been written, along with a
+  // report of any messages dropped so far.
+  void Flush() {
+    const std::uint64_t count = logged.load() + dropped.load();
+    if (count == flushedCount.load()) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    const std::uint64_t request = ++flushRequests;
+    wake.notify_all();
+    flushed.wait(lock, [&]() { return flushesDone >= request; });
+    flushedCount.store(count);
+  }
+
+  // Whether messages are written to standard output.
+  bool ToStdout() const { return fd == STDOUT_FILENO; }
+
+  // The sink installed by AixLog::Log::init(), if any.
+  static Sink* current;
+
+  // The number of messages dropped so far.
+  std::uint64_t Dropped() const { return dropped.load(); }
+};
+std::atomic<std::uint64_t> Sink::nextId{1};
+Sink* Sink::current = nullptr;
+
+// Write out every message logged so far and flush std::cout. Call this before
+// and after writing program output to std::cout, so that it stays in order
+// with the log messages when both go to standard output.
+void Sync() {
+  Sink* sink = Sink::current;
+  if (sink && sink->ToStdout()) sink->Flush();
+  std::cout.flush();
+}
+
+}  // namespace AsyncLog
+
+#endif  // ASYNCLOG_HPP
@@ -3,6 +3,10 @@
 
 // Global variables and data types.
 
+#include <ostream>
+#include <string>
+#include <vector>
+
 #include "aixlog.hpp"
 
 // The default class type.
@@ -74,11 +78,60 @@ std::ostream& operator<<(std::ostream& os, const ClassType& c) {
   return os;
 }
 
+// The approach used to find the relevant nodes in the AST.
+enum class Extraction {
+  TreeWalk,   // Visit every node of the input files from the top down.
+  MemoryPool  // Linearly scan only the memory pools of relevant node types.
+};
+std::ostream& operator<<(std::ostream& os, const Extraction& e) {
+  switch (e) {
+    case Extraction::TreeWalk:
+      os << "TreeWalk";
+      break;
+    case Extraction::MemoryPool:
+      os << "MemoryPool";
+      break;
+    default:
+      LOG(FATAL) << "Attempted to print unspecified Extraction" << std::endl;
+  }
+  return os;
+}
+
 // Global options set via command line.
 AixLog::Severity debug = AixLog::Severity::fatal;
+
+// Lines below the --lcom:debug level are dropped by the sink, but their
+// operands would still be evaluated, resolving and caching the name of every
+// node they print. LOG therefore skips such lines entirely. The line is an
+// operand of &, which binds looser than <<, so it can be followed by <<.
+struct LogVoidify {
+  void operator&(std::ostream&) {}
+};
+#undef LOG
+#define LOG(SEVERITY)                                              \
+  static_cast<AixLog::Severity>(SEVERITY) < ::debug                \
+      ? (void)0                                                    \
+      : LogVoidify() & AIXLOG_INTERNAL__LOG_SEVERITY(SEVERITY)     \
+                           << TIMESTAMP << FUNC
+
 bool anonymous = false;
 bool filterUndefinedMethods = false;
 bool filterCtorsDtors = false;
 DotBehavior dotBehavior = DotBehavior::LeftOnly;
+// Not a command line option: the memory pool scan is only run by the unit
+// tests until it is shown to produce the same class data as the tree walk.
+Extraction extraction = Extraction::TreeWalk;
+// Optional paths to ROSE binary AST files. If astInput is set, the AST is
+// loaded from it instead of running the frontend. If astOutput is set, the AST
+// is saved to it so later runs can skip the frontend.
+std::string astInput;
+std::string astOutput;
+// Directories containing the analyzed sources. When set, declarations and
+// subtrees located outside of these roots (e.g., system headers) are skipped
+// during extraction.
+std::vector<std::string> sourceRoots;
+// Set once the AST has been deleted. Node pointers may still be compared as
+// IDs afterwards, but must never be dereferenced.
+bool astReleased = false;
 
 #endif  // DEFINE_HPP
\ No newline at end of file
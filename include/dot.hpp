@@ -0,0 +1,505 @@
+#ifndef DOT_HPP
+#define DOT_HPP
+
+// DOT graphs of the LCOM relationships within each class.
+// Method names are read from the AST, so graphs must be generated before it is
+// released.
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "aixlog.hpp"
+#include "anonymize.hpp"
+#include "define.hpp"
+#include "lcom.hpp"
+#include "node-print.hpp"
+#include "output.hpp"
+#include "profile.hpp"
+#include "traverse.hpp"
+
+namespace DOT {
+
+using Method = Traverse::MType;
+using Attribute = Traverse::AType;
+
+// Classes with more methods than this are drawn condensed, with a node per
+// LCOM4 component and per record attribute instead of a node per method and
+// field. 0 never condenses.
+std::size_t condenseThreshold = 0;
+// Methods whose LCOM4 component is still drawn in full within a condensed
+// graph.
+std::vector<std::string> expandMethods;
+
+// The DOT identifier of an AST node, a prefix followed by its address. It is
+// written straight to the stream, so naming a node allocates nothing.
+struct NodeId {
+  char prefix;
+  const void* node;
+};
+
+std::ostream& operator<<(std::ostream& os, const NodeId& id) {
+  return os << id.prefix << std::size_t(id.node);
+}
+
+NodeId PName(const SgNode* n) { return NodeId{'p', n}; }
+
+void Header(std::ostream& os) {
+  os << "digraph {\n";
+  os << "  compound=true;\n";
+  os << "  rankdir=\"BT\"\n";
+  os << "  style=\"rounded\";\n";
+}
+
+void Footer(std::ostream& os) { os << "}\n"; }
+
+template <typename Src, typename Tgt>
+void Edge(std::ostream& os, const Src& src, const Tgt& tgt,
+          const std::string& lbl, const std::string& attr) {
+  os << "  " << src << " -> " << tgt << "[ taillabel = \"" << lbl << "\" "
+     << attr << "];\n";
+}
+
+template <typename Id>
+void Node(std::ostream& os, const Id& n, const std::string& lbl,
+          const std::string& attr) {
+  os << "  " << n << "[ label = \"" << lbl << "\" " << attr << "];\n";
+}
+
+template <typename C>
+std::set<Method> GetMethods(
+    const LCOM::Class<C, Method, Attribute>& LCOMInput) {
+  std::set<Method> methods;
+  for (const auto& method : LCOMInput.methods) {
+    methods.insert(method.GetId());
+  }
+  return methods;
+}
+
+// An attribute node used to form a tree.
+struct ANode {
+  // The ID of the attribute.
+  const Attribute::T id;
+  // The parent node.
+  const ANode* parent = nullptr;
+  // The name of the attribute.
+  const std::string name;
+  // Methods that access this specific attribute.
+  std::set<Method> methods;
+  // Increasingly specialized fields associated with an attribute.
+  std::map<Attribute::T, ANode*> fields;
+  // The DOT identifier of the node. Set by NameNodes.
+  std::string pname;
+
+  ANode(const Attribute::T id, const ANode* parent = nullptr,
+        const std::string name = "")
+      : id(id), parent(parent), name(name) {}
+  // Recursively free the tree.
+  ~ANode() {
+    for (auto& field : fields) {
+      delete field.second;
+    }
+  }
+
+  const ANode* GetNonCluster() const {
+    for (const auto& field : fields) {
+      // Found a non-cluster.
+      // This is a leaf node because there are no child fields beneath it.
+      if (!field.second->fields.size()) return field.second;
+      // Recursively search for some non-cluster.
+      const ANode* ret = field.second->GetNonCluster();
+      if (ret) return ret;
+    }
+    return nullptr;
+  }
+
+  const std::string& PName() const { return pname; }
+};
+
+// Number the nodes of a tree in DFS order, so every node name is built once
+// instead of from all of its ancestors whenever it is used.
+void NameNodes(ANode* a, const std::string& prefix, std::size_t& next) {
+  a->pname = prefix + std::to_string(next++);
+  for (auto& field : a->fields) {
+    NameNodes(field.second, prefix, next);
+  }
+}
+
+// Node names start with prefix, which must differ between trees drawn into the
+// same graph.
+template <typename C>
+ANode* GetTree(const LCOM::Class<C, Method, Attribute>& LCOMInput,
+               const std::string& prefix) {
+  ANode* root = new ANode(nullptr);
+  if (!root) LOG(FATAL) << "Failed to allocate the root node." << std::endl;
+  for (const auto& method : LCOMInput.methods) {
+    for (const auto& a : method.attributes) {
+      const Traverse::AType& aType = a.GetId();
+      //  Build up each attribute within the tree.
+      ANode* curr = root;
+      for (auto it = aType.cbegin(); it != aType.cend(); ++it) {
+        auto field = curr->fields.find(*it);
+        // Only name fields that are new to the tree.
+        if (field == curr->fields.end()) {
+          const std::string& name = NPrint::source_name(*it);
+          field = curr->fields.emplace(*it, new ANode(*it, curr, name)).first;
+          if (!field->second)
+            LOG(FATAL) << "Failed to allocate a node for " << name << "."
+                       << std::endl;
+        }
+        curr = field->second;
+      }
+      curr->methods.emplace(method.GetId());
+    }
+  }
+  std::size_t next = 0;
+  NameNodes(root, prefix, next);
+  return root;
+}
+
+void PrintTreeAttributes(std::ostream& os, const ANode* a) {
+  if (!a) return;
+  // Special case for root node.
+  if (!a->id) {
+    for (const auto& field : a->fields) {
+      PrintTreeAttributes(os, field.second);
+    }
+    return;
+  }
+  // Special case for clusters.
+  if (a->fields.size() > 0) {
+    os << "  subgraph cluster_" << a->PName() << " {\n";
+    os << "  label=\"" << a->name << "\"\n";
+    for (const auto& field : a->fields) {
+      PrintTreeAttributes(os, field.second);
+    }
+    os << "  }\n";
+  } else {
+    Node(os, a->PName(), a->name, "shape=ellipse");
+  }
+  return;
+}
+
+// The label of a method node.
+const std::string& MethodName(const Method method) {
+  if (!method) {
+    LOG(FATAL) << "Unable to resolve method " << NPrint::p(method) << std::endl;
+    static const std::string null = "null";
+    return null;
+  }
+  NPrint::NameCache& cache = NPrint::NameCache::inst();
+  const auto declared = [&]() -> const std::string& {
+    return cache.Get(method, &NPrint::NameCache::Names::declaredName,
+                     [method]() { return method->get_name().getString(); });
+  };
+  if (!anonymous) return declared();
+  return cache.Get(method, &NPrint::NameCache::Names::anonymizedName,
+                   [&]() { return Anonymize::Hash(declared()); });
+}
+
+void PrintMethods(std::ostream& os, const std::set<Method> methods) {
+  for (const auto& method : methods) {
+    Node(os, PName(method), MethodName(method), "shape=polygon");
+  }
+}
+
+void PrintConnections(std::ostream& os, const ANode* a) {
+  if (!a) return;
+  const ANode* idNode = a;
+  std::string attribute;
+  // If this is a cluster, we must instead point to something within it that is
+  // not a cluster.
+  if (a->fields.size()) {
+    idNode = a->GetNonCluster();
+    attribute = "lhead=cluster_" + a->PName();
+  }
+  for (const auto& method : a->methods) {
+    const SgNode* mNode = isSgNode(method);
+    Edge(os, PName(mNode), idNode->PName(), "", attribute);
+  }
+  for (const auto& field : a->fields) {
+    PrintConnections(os, field.second);
+  }
+  return;
+}
+
+template <typename C>
+void printMethodConnections(
+    std::ostream& os, const LCOM::Class<C, Method, Attribute>& LCOMInput) {
+  for (const auto& method : LCOMInput.methods) {
+    for (const auto& calledMethod : method.calledMethods) {
+      Edge(os, PName(method.GetId()), PName(calledMethod.GetId()), "", "");
+    }
+  }
+}
+
+// Ensure nodes are properly grouped at the same level.
+void GroupNodes(std::ostream& os, const std::set<SgNode*> map) {
+  os << "  { rank=same; ";
+  for (const auto& n : map) {
+    os << PName(n) << "; ";
+  }
+  os << "}\n";
+}
+
+// Draw the methods and attributes of a class in full, without the graph
+// around them.
+template <typename C>
+void PrintDetail(std::ostream& os,
+                 const LCOM::Class<C, Method, Attribute>& LCOMInput,
+                 const std::string& prefix) {
+  const ANode* tree = GetTree(LCOMInput, prefix);
+  PrintTreeAttributes(os, tree);
+  PrintMethods(os, GetMethods(LCOMInput));
+  PrintConnections(os, tree);
+  printMethodConnections(os, LCOMInput);
+  delete tree;
+}
+
+// Convert a large class into a DOT graph of its LCOM4 components.
+// Each component becomes a single node, labeled with one of its methods and
+// its method count, and each record attribute a single node, labeled with the
+// number of distinct fields accessed. An edge from a component to an attribute
+// is labeled with the number of accesses between them. Components holding a
+// method in expandMethods are drawn in full instead, in a cluster of their
+// own.
+template <typename C>
+void CondensedToDOT(std::ostream& os,
+                    const LCOM::Class<C, Method, Attribute>& LCOMInput) {
+  struct Component {
+    std::vector<const LCOM::Method<Method, Attribute>*> methods;
+    // Accesses per record attribute.
+    std::map<Attribute::T, std::size_t> accesses;
+    bool expanded = false;
+  };
+  const std::map<Method, std::size_t> componentIds =
+      LCOM::LCOM4Components(LCOMInput);
+  std::vector<Component> components;
+  // The distinct fields accessed within each record attribute.
+  std::map<Attribute::T, std::set<Attribute>> fields;
+  for (const auto& method : LCOMInput.methods) {
+    const std::size_t id = componentIds.at(method.GetId());
+    if (id >= components.size()) components.resize(id + 1);
+    Component& component = components[id];
+    component.methods.push_back(&method);
+    if (std::find(expandMethods.cbegin(), expandMethods.cend(),
+                  MethodName(method.GetId())) != expandMethods.cend()) {
+      component.expanded = true;
+    }
+    for (const auto& attribute : method.attributes) {
+      const Attribute& path = attribute.GetId();
+      component.accesses[path.GetId()]++;
+      fields[path.GetId()].insert(path);
+    }
+  }
+
+  Header(os);
+  std::set<Attribute::T> records;
+  for (std::size_t i = 0; i < components.size(); ++i) {
+    const Component& component = components[i];
+    const std::string id = "c" + std::to_string(i);
+    if (component.expanded) {
+      LCOM::Class<C, Method, Attribute> part(LCOMInput.GetId());
+      for (const auto& method : component.methods) part.methods.insert(*method);
+      os << "  subgraph cluster_" << id << " {\n";
+      os << "  label=\"Component " << i << "\"\n";
+      PrintDetail(os, part, id + "a");
+      os << "  }\n";
+      continue;
+    }
+    std::stringstream label;
+    label << MethodName(component.methods.front()->GetId());
+    if (component.methods.size() > 1)
+      label << "\\n+" << component.methods.size() - 1 << " methods";
+    Node(os, id, label.str(), "shape=box3d");
+    for (const auto& access : component.accesses) {
+      records.insert(access.first);
+      Edge(os, id, NodeId{'r', access.first}, std::to_string(access.second),
+           "");
+    }
+  }
+  for (const auto& record : records) {
+    std::stringstream label;
+    label << NPrint::source_name(record);
+    const std::set<Attribute>& recordFields = fields.at(record);
+    if (recordFields.size() > 1 || recordFields.begin()->GetIds().size() > 1)
+      label << "\\n" << recordFields.size() << " fields";
+    Node(os, NodeId{'r', record}, label.str(), "shape=ellipse");
+  }
+  Footer(os);
+}
+
+// Convert LCOM graph data into a DOT graph.
+template <typename C>
+void LCOMToDOT(std::ostream& os,
+               const LCOM::Class<C, Method, Attribute>& LCOMInput) {
+  if (condenseThreshold > 0 && LCOMInput.methods.size() > condenseThreshold) {
+    CondensedToDOT(os, LCOMInput);
+    return;
+  }
+  Header(os);
+  PrintDetail(os, LCOMInput, "a");
+  std::set<Method> methods = GetMethods(LCOMInput);
+  std::set<SgNode*> methodNodes = [&methods]() -> auto {
+    std::set<SgNode*> nodes;
+    for (const auto& method : methods) {
+      nodes.insert(is<SgNode>(method));
+    }
+    return nodes;
+  }();
+  GroupNodes(os, methodNodes);
+  Footer(os);
+}
+
+// Where the graphs of a run are written.
+class Sink {
+ public:
+  virtual ~Sink() = default;
+  // graph is only valid during the call.
+  virtual void Write(const std::string& className,
+                     const boost::filesystem::path& sourceFile,
+                     const std::string& graph) = 0;
+  // Finish the output. Returns false if it could not be saved.
+  virtual bool Close() { return true; }
+};
+
+// One file per class, named "<source>_<class>.lcom.dot", next to its source
+// file or in dotPath.
+class FileSink : public Sink {
+  const boost::filesystem::path dotPath;
+  // Whether every graph so far was saved.
+  bool ok = true;
+
+ public:
+  explicit FileSink(const boost::filesystem::path& dotPath)
+      : dotPath(dotPath) {}
+
+  void Write(const std::string& className,
+             const boost::filesystem::path& sourceFile,
+             const std::string& graph) override {
+    boost::filesystem::path outfile;
+    if (dotPath.empty()) {
+      outfile = sourceFile;
+    } else {
+      outfile = dotPath / sourceFile.filename();
+    }
+    outfile = outfile.parent_path() /
+              boost::filesystem::path(outfile.filename().string() + "_" +
+                                      className + ".lcom.dot");
+    LOG(NOTICE) << "Saving to " << outfile << std::endl;
+    std::fstream out(outfile.string(), std::ios::out);
+    out << graph;
+    out.close();
+    if (out.fail()) {
+      LOG(ERROR) << "Unable to write " << outfile << "." << std::endl;
+      ok = false;
+    }
+  }
+
+  bool Close() override { return ok; }
+};
+
+// Every graph of a run in a single file, for runs with too many classes to
+// write a file each.
+// The graphs are simply concatenated, which Graphviz reads as one graph after
+// another. An index next to it, at path + ".idx", has one line per graph with
+// its byte offset, its length in bytes, its class name and its source file,
+// separated by tabs, so any graph can be read without scanning the others.
+// script/lcom_dot_bundle.py lists and extracts graphs this way.
+class BundleSink : public Sink {
+  Output::File bundle;
+  Output::File index;
+  std::uint64_t offset = 0;
+
+ public:
+  explicit BundleSink(const boost::filesystem::path& path)
+      : bundle(path), index(path.string() + ".idx") {}
+
+  void Write(const std::string& className,
+             const boost::filesystem::path& sourceFile,
+             const std::string& graph) override {
+    bundle.Stream() << graph;
+    index.Stream() << offset << '\t' << graph.size() << '\t' << className
+                   << '\t' << sourceFile.string() << '\n';
+    offset += graph.size();
+  }
+
+  // The index is only moved into place once the bundle is.
+  bool Close() override { return bundle.Commit() && index.Commit(); }
+};
+
+// A bundle at bundlePath if set, or a file per class otherwise.
+std::unique_ptr<Sink> MakeSink(const boost::filesystem::path& dotPath,
+                               const boost::filesystem::path& bundlePath) {
+  if (bundlePath.empty()) return std::make_unique<FileSink>(dotPath);
+  if (!dotPath.empty())
+    LOG(WARNING) << "--lcom:dot-output is ignored, as --lcom:dot-bundle was "
+                    "given."
+                 << std::endl;
+  LOG(DEBUG) << "Bundling DOT graphs in " << bundlePath << std::endl;
+  return std::make_unique<BundleSink>(bundlePath);
+}
+
+// A stream buffer appending to a string. Unlike std::stringbuf, the string
+// can be cleared without releasing its capacity and read without a copy.
+class StringBuffer : public std::streambuf {
+  std::string& s;
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      s.push_back(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char* p, std::streamsize n) override {
+    s.append(p, n);
+    return n;
+  }
+
+ public:
+  explicit StringBuffer(std::string& s) : s(s) {}
+};
+
+// Write a DOT graph for each class to sink.
+template <typename C>
+void GenerateLCOMGraphs(
+    const std::vector<LCOM::Class<C, Method, Attribute>>& LCOMInput,
+    Sink& sink) {
+  // Cleared for every graph, keeping its capacity, so it only grows to the
+  // largest one.
+  std::string graph;
+  StringBuffer buffer(graph);
+  std::ostream os(&buffer);
+  for (const auto& classInst : LCOMInput) {
+    std::string className = "null";
+    if (is<C>(classInst.GetId())) {
+      Traverse::Class<C>& classInstObj =
+          Traverse::IA<C>::classData.at(classInst.GetId());
+      std::stringstream ss;
+      ss << classInstObj;
+      className = ss.str();
+    } else {
+      LOG(WARNING) << "No class name found for " << classInst << std::endl;
+    }
+    const boost::filesystem::path sourceFile =
+        Traverse::IA<C>::classData.at(classInst.GetId()).sourceFile;
+    Profile::Scope scope("DOTOutput", typeid(C).name(), className);
+    graph.clear();
+    LCOMToDOT(os, classInst);
+    sink.Write(className, sourceFile, graph);
+  }
+}
+
+}  // namespace DOT
+
+#endif  // DOT_HPP
@@ -7,6 +7,9 @@
 // This code uses templates to allow any type that supports comparison to work 
 // as a class, method, or attribute.
 
+// Define LCOM_STANDALONE to use this header without ROSE, e.g. to benchmark
+// the metrics on synthetic ids. Ids are then printed with operator<<.
+
 #include <algorithm>
 #include <boost/any.hpp>
 #include <boost/optional.hpp>
@@ -16,6 +19,8 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <sstream>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -23,8 +28,29 @@
 #include <vector>
 
 #include "aixlog.hpp"
+#ifndef LCOM_STANDALONE
 #include "define.hpp"
 #include "node-print.hpp"
+#endif
+#include "profile.hpp"
+#include "stats.hpp"
+
+#ifdef LCOM_STANDALONE
+namespace NPrint {
+template <typename T>
+std::string print(const T& n) {
+  std::stringstream ss;
+  ss << n;
+  return ss.str();
+}
+#define p(n) print(n)
+}  // namespace NPrint
+#endif
+
+// Hot-path counters for the LCOM kernels, printed by --lcom:stats.
+Stats::Counter disjointSetUnions("DisjointSet unions");
+Stats::Counter disjointSetFindSteps("DisjointSet find steps");
+Stats::Counter sharedPairComparisons("GetNumSharedPairs attribute comparisons");
 
 template <typename T>
 class DisjointSet {
@@ -42,6 +68,7 @@ class DisjointSet {
   }
   // Find the "root" parent object associated with a set.
   T Find(T object) {
+    disjointSetFindSteps.Add();
     if (parent[object] == object) {
       return object;
     }
@@ -56,6 +83,7 @@ class DisjointSet {
     if (a == b) {
       return;
     }
+    disjointSetUnions.Add();
     // Set a should always be largest.
     // This is done to minimize the recursive search depth needed by Find().
     if (size[a] < size[b]) {
@@ -322,6 +350,18 @@ class Class {
   std::set<Method<U, V>> methods;
 };
 
+// Approximate heap bytes held by a class and its methods.
+template <typename T, typename U, typename V>
+std::size_t ApproxBytes(const Class<T, U, V>& classInput) {
+  std::size_t bytes =
+      sizeof(classInput) + Profile::NodeBytes(classInput.methods);
+  for (const auto& method : classInput.methods) {
+    bytes += Profile::NodeBytes(method.attributes);
+    bytes += method.calledMethods.capacity() * sizeof(Method<U, V>);
+  }
+  return bytes;
+}
+
 // Can be used by LCOM1 and LCOM2 to normalize on a range from 0-1.
 inline std::size_t UniquePairs(const std::size_t n) { return n * (n - 1) / 2; }
 
@@ -349,6 +389,7 @@ std::size_t GetNumSharedPairs(std::set<Method<U, V>> methodSet) {
       // For each pair of attributes.
       for (auto attrA : (*imA).attributes) {
         for (auto attrB : (*imB).attributes) {
+          sharedPairComparisons.Add();
           // NOTE: When V is AType, == is overridden to make this work properly.
           if (attrA.GetId() == attrB.GetId()) {
             count++;
@@ -492,6 +533,20 @@ std::size_t LCOM4(const Class<T, U, V>& classInput) {
   return set.GetNumSets();
 }
 
+// The LCOM4 component of each method, numbered from 0 in method order.
+template <typename T, typename U, typename V>
+std::map<U, std::size_t> LCOM4Components(const Class<T, U, V>& classInput) {
+  DisjointSet<U> set = Class<T, U, V>::LCOM3ToLCOM4Set(
+      classInput, Class<T, U, V>::GetLCOM3Set(classInput));
+  std::map<U, std::size_t> roots;
+  std::map<U, std::size_t> components;
+  for (const auto& method : classInput.methods) {
+    const auto root = roots.emplace(set.Find(method.GetId()), roots.size());
+    components.emplace(method.GetId(), root.first->second);
+  }
+  return components;
+}
+
 // The sum of non-module attributes accessed by a class.
 // TODO: It is unclear with DotBehavior::Full just how many accesses there are
 // per record.
@@ -1,13 +1,17 @@
 #ifndef NODE_PRINT_HPP
 #define NODE_PRINT_HPP
 
+#include <boost/optional.hpp>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
+#include "anonymize.hpp"
 #include "sageGeneric.h"
 // May need to define Sage Interface first to avoid conflicts.
 #include "define.hpp"
 #include "sageInterface.h"
+#include "stats.hpp"
 
 namespace NPrint {
 
@@ -86,30 +90,101 @@ auto NPrint::get_print_name_impl(const SgAdaProtectedSpec& n) {
   return n.get_qualified_name();
 }
 
-std::string print(const SgNode* n) {
-  std::stringstream ss;
-  ss << n;
-  if (n == nullptr) return ss.str();
-  if (!anonymous) {
-    std::string dispatch = sg::dispatch(NPrint{}, n);
-    ss << " (" << dispatch << ")";
+Stats::Counter nameCacheHits("NPrint name cache hits");
+Stats::Counter nameCacheMisses("NPrint name cache misses");
+
+// Resolving a name dispatches on the node type and often unparses it, which
+// is expensive, and the same nodes are named over and over by the log, the
+// CSV output and the DOT output. Every form of a node's name is therefore
+// resolved once, on first use, and kept until the AST is released. LOG skips
+// the lines the log would drop (see define.hpp), so only names that are
+// written somewhere are cached.
+// NOTE: The cache is not synchronized, so names must be resolved from a
+// single thread.
+class NameCache {
+  static NameCache instance;
+  NameCache() {}
+
+ public:
+  static NameCache& inst() { return instance; }
+
+  struct Names {
+    // The name found by dispatching on the node type.
+    boost::optional<std::string> simple;
+    // The log label: the address, the simple name and the node type.
+    boost::optional<std::string> label;
+    // The unparsed source of the node.
+    boost::optional<std::string> unparsed;
+    // A hash of the unparsed source, used in place of it by --lcom:anonymous.
+    boost::optional<std::string> anonymized;
+    // The declared name of a method, used by DOT::MethodName.
+    boost::optional<std::string> declaredName;
+    // A hash of the declared name, used in place of it by --lcom:anonymous.
+    boost::optional<std::string> anonymizedName;
+  };
+  std::unordered_map<const SgNode*, Names> names;
+
+  // Get the name stored in field, resolving it first if needed.
+  template <typename F>
+  const std::string& Get(const SgNode* n,
+                         boost::optional<std::string> Names::*field,
+                         F resolve) {
+    boost::optional<std::string>& name = names[n].*field;
+    if (name) {
+      nameCacheHits.Add();
+    } else {
+      nameCacheMisses.Add();
+      name = resolve();
+    }
+    return *name;
   }
-  ss << " (" << n->class_name() << ")";
-  return ss.str();
-}
+};
+NameCache NameCache::instance;
+
+// Drop every cached name. Must be called when the AST is released, as the
+// addresses of released nodes may be reused.
+void Clear() { NameCache::inst().names.clear(); }
 
 std::string simple_name(const SgNode* n) {
   if (n == nullptr) return "<null>";
 
   std::stringstream ss;
 
-  if (anonymous)
+  if (anonymous || astReleased)
   {
     ss << n;
     return ss.str();
   }
 
-  return sg::dispatch(NPrint{}, n);
+  return NameCache::inst().Get(n, &NameCache::Names::simple,
+                               [n]() { return sg::dispatch(NPrint{}, n); });
+}
+
+std::string print(const SgNode* n) {
+  std::stringstream ss;
+  ss << n;
+  if (n == nullptr || astReleased) return ss.str();
+  if (anonymous) {
+    ss << " (" << n->class_name() << ")";
+    return ss.str();
+  }
+  return NameCache::inst().Get(n, &NameCache::Names::label, [&]() {
+    ss << " (" << simple_name(n) << ")";
+    ss << " (" << n->class_name() << ")";
+    return ss.str();
+  });
+}
+
+// The unparsed source of a node, or its hash with --lcom:anonymous.
+const std::string& source_name(const SgNode* n) {
+  NameCache& cache = NameCache::inst();
+  const auto unparsed = [&]() -> const std::string& {
+    return cache.Get(n, &NameCache::Names::unparsed,
+                     [n]() { return n->unparseToString(); });
+  };
+  if (!anonymous) return unparsed();
+  return cache.Get(n, &NameCache::Names::anonymized,
+                   [&]() { return Anonymize::Hash(unparsed()); });
 }
 
 
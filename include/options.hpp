@@ -0,0 +1,192 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+// Command line switches shared by lcom.out and lcom-dot.out.
+// Both tools load and extract class data the same way, so the switches that
+// control the frontend, the extraction and the instrumentation are defined
+// once here. Each tool adds the switches of its own outputs to the group.
+
+#include <Rose/CommandLine.h>
+#include <Sawyer/CommandLine.h>
+
+#include <string>
+#include <vector>
+
+#include "aixlog.hpp"
+#include "anonymize.hpp"
+#include "asynclog.hpp"
+#include "define.hpp"
+#include "dot.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+namespace Options {
+
+namespace scl = Sawyer::CommandLine;
+
+// The "lcom" switch group, holding the switches common to every tool.
+scl::SwitchGroup CommonSwitches(ClassType& classType) {
+  // Create a group of switches specific to this tool
+  scl::SwitchGroup lcomArgs("Lack of Cohesion of Methods (LCOM) switches");
+  lcomArgs.name("lcom");
+  lcomArgs.insert(scl::Switch("debug")
+                      .argument("[trace|debug|info|notice|warning|error|fatal]",
+                                scl::enumParser<AixLog::Severity>(debug)
+                                    ->with("trace", AixLog::Severity::trace)
+                                    ->with("debug", AixLog::Severity::debug)
+                                    ->with("info", AixLog::Severity::info)
+                                    ->with("notice", AixLog::Severity::notice)
+                                    ->with("warning", AixLog::Severity::warning)
+                                    ->with("error", AixLog::Severity::error)
+                                    ->with("fatal", AixLog::Severity::fatal))
+                      .doc("Specifies a logging severity level."));
+  lcomArgs.insert(
+      scl::Switch("log-file")
+          .argument("filename", scl::anyParser(AsyncLog::outputPath))
+          .doc("Write log messages to this file instead of standard output."));
+  lcomArgs.insert(scl::Switch("anonymous")
+                      .intrinsicValue("true", scl::booleanParser(anonymous))
+                      .doc("Disable component name resolution."));
+  lcomArgs.insert(
+      scl::Switch("anonymous-key")
+          .argument("key", scl::anyParser(Anonymize::key))
+          .doc("Hash anonymized names and paths with SipHash-2-4 under this "
+               "key instead of XXH64. Runs sharing a key produce the same "
+               "IDs, so their results can be joined, while guessed names "
+               "cannot be checked against them without the key. Implies "
+               "--lcom:anonymous."));
+  lcomArgs.insert(
+      scl::Switch("dot-behavior")
+          .argument("[LeftOnly|Full]",
+                    scl::enumParser<DotBehavior>(dotBehavior)
+                        ->with("LeftOnly", DotBehavior::LeftOnly)
+                        ->with("Full", DotBehavior::Full))
+          .doc("Specifies the behavior of record field accesses.\n"
+               "\tLeftOnly: Any access to the left or right part of a dot "
+               "operator is viewed as an access to only the left part.\n"
+               "\tFull: Any access to the right part of the dot operator is "
+               "viewed as an access to the right part, but it is disambiguated "
+               "from other instances of the record using the left part. Any "
+               "access to the left part is viewed as an overlapping access to "
+               "any right parts contained within.\n"));
+  lcomArgs.insert(
+      scl::Switch("class-type")
+          .argument("[Default|Package|Function|Class|ProtectedObject|Namespace|All]",
+                    scl::enumParser<ClassType>(classType)
+                        ->with("Package", ClassType::Package)
+                        ->with("Function", ClassType::Function)
+                        ->with("Class", ClassType::Class)
+                        ->with("ProtectedObject", ClassType::ProtectedObject)
+                        ->with("Namespace", ClassType::Namespace)
+                        ->with("Default", ClassType::Default)
+                        ->with("All", ClassType::All))
+          .doc(std::string(
+                   "The program unit to use as the LCOM class. \"All\" will "
+                   "run analysis on all predefined class types. Defaults to ") +
+               typeid(Class).name() + "."));
+  lcomArgs.insert(
+      scl::Switch("filter-undefined-methods")
+          .intrinsicValue("true", scl::booleanParser(filterUndefinedMethods))
+          .doc("Filter out methods that are not defined."));
+  lcomArgs.insert(
+      scl::Switch("filter-ctors-dtors")
+          .intrinsicValue("true", scl::booleanParser(filterCtorsDtors))
+          .doc("Filter out constructors and destructors."));
+  lcomArgs.insert(
+      scl::Switch("ast-input")
+          .argument("filename", scl::anyParser(astInput))
+          .doc("Load a ROSE binary AST saved by --lcom:ast-output instead of "
+               "running the frontend on the source files."));
+  lcomArgs.insert(
+      scl::Switch("ast-output")
+          .argument("filename", scl::anyParser(astOutput))
+          .doc("Save the ROSE AST in binary form after parsing. The file can "
+               "be passed to --lcom:ast-input to skip the frontend in later "
+               "runs."));
+  lcomArgs.insert(
+      scl::Switch("source-root")
+          .argument("directory", scl::anyParser(sourceRoots))
+          .whichValue(scl::SAVE_ALL)
+          .doc("Only analyze code located within this directory. Subtrees "
+               "and references to declarations outside of every source root, "
+               "such as system and STL headers, are skipped during "
+               "extraction. May be specified multiple times. By default, "
+               "nothing is skipped."));
+  lcomArgs.insert(
+      scl::Switch("profile")
+          .argument("filename", scl::anyParser(Profile::outputPath))
+          .doc("Record the wall and CPU time of each analysis phase, per "
+               "class where applicable, and save them to this file as JSON."));
+  lcomArgs.insert(
+      scl::Switch("perf-counters")
+          .intrinsicValue("true", scl::booleanParser(Perf::requested))
+          .doc("Also record instructions, cycles, cache misses and branch "
+               "misses for each phase in the --lcom:profile output, using "
+               "Linux perf_event_open. Skipped with a warning if the kernel "
+               "does not allow it."));
+  lcomArgs.insert(
+      scl::Switch("trace")
+          .argument("filename", scl::anyParser(Trace::outputPath))
+          .doc("Record a span for each analysis phase and save them to this "
+               "file in Chrome trace-event JSON format, for viewing in "
+               "chrome://tracing or Perfetto."));
+  lcomArgs.insert(
+      scl::Switch("stats")
+          .argument("[table|json]",
+                    scl::enumParser<Stats::Format>(Stats::format)
+                        ->with("table", Stats::Format::Table)
+                        ->with("json", Stats::Format::JSON),
+                    "table")
+          .doc("Count events on the extraction and LCOM hot paths, such as "
+               "nodes visited per variant, recursion depths, alias map hits "
+               "and pair comparisons, and print them at the end of the run. "
+               "Defaults to a table."));
+  return lcomArgs;
+}
+
+// Add the switches controlling how DOT graphs are drawn.
+void InsertDOTSwitches(scl::SwitchGroup& lcomArgs) {
+  lcomArgs.insert(
+      scl::Switch("dot-condense")
+          .argument("methods", scl::nonNegativeIntegerParser(
+                                   DOT::condenseThreshold))
+          .doc("Draw classes with more than this many methods condensed: "
+               "each LCOM4 component becomes a single node labeled with one "
+               "of its methods and its method count, and each record "
+               "attribute a single node labeled with the number of fields "
+               "accessed. Edges are labeled with the number of accesses. "
+               "Large graphs otherwise take Graphviz very long to lay out. "
+               "Defaults to 0, which never condenses."));
+  lcomArgs.insert(
+      scl::Switch("dot-expand")
+          .argument("method", scl::anyParser(DOT::expandMethods))
+          .whichValue(scl::SAVE_ALL)
+          .doc("In condensed graphs, still draw the component holding the "
+               "method with this name in full. May be specified multiple "
+               "times."));
+}
+
+// Parse the command line with the "lcom" switch group and start logging.
+// Returns the arguments left for the frontend.
+std::vector<std::string> Parse(const std::string& purpose,
+                               const std::string& description,
+                               const scl::SwitchGroup& lcomArgs,
+                               const std::vector<std::string>& args) {
+  scl::Parser p =
+      Rose::CommandLine::createEmptyParserStage(purpose, description);
+  p.with(Rose::CommandLine::genericSwitches());
+  scl::ParserResult cmdline = p.with(lcomArgs).parse(args).apply();
+  if (!Anonymize::key.empty()) anonymous = true;
+  Anonymize::SetKey(Anonymize::key);
+
+  // Initialize the logger here.
+  // AixLog::Log::init<AixLog::SinkCout>(debug);
+  AixLog::Log::init<AsyncLog::Sink>(debug);
+
+  return cmdline.unparsedArgs();
+}
+
+}  // namespace Options
+
+#endif  // OPTIONS_HPP
@@ -0,0 +1,667 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+// Output sinks for the per-class LCOM metrics.
+// ProcessLCOM hands every class to a Sink as a Row, as soon as its metrics are
+// computed, and the sink streams it straight to its file.
+// Files are written to a temporary file next to the destination through a
+// large buffer, and only renamed over the destination once complete, so
+// readers never see a partially written file. Alternatively, many processes
+// can append to one shared file.
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aixlog.hpp"
+#include "lcom.hpp"
+#include "trace.hpp"
+
+namespace Output {
+
+// The buffer size of output files.
+constexpr std::size_t bufferBytes = std::size_t(1) << 20;
+
+// The methods and attributes of a class and how they are connected.
+// Edges refer to methods and attributes by their index.
+struct Detail {
+  std::vector<std::string> methods;
+  // The LCOM4 component of each method.
+  std::vector<std::size_t> components;
+  // Each attribute as the path from the class down to the accessed member.
+  std::vector<std::vector<std::string>> attributes;
+  // (method, attribute) pairs.
+  std::vector<std::pair<std::size_t, std::size_t>> accesses;
+  // (caller, callee) pairs. Calls to methods outside the class are left out.
+  std::vector<std::pair<std::size_t, std::size_t>> calls;
+};
+
+// The metrics of a single class.
+struct Row {
+  boost::filesystem::path sourceFile;
+  std::string className;
+  std::string classType;
+  std::string dotBehavior;
+  std::size_t LCOM1 = 0;
+  std::size_t LCOM2 = 0;
+  std::size_t LCOM3 = 0;
+  std::size_t LCOM4 = 0;
+  double LCOM5 = 0;
+  LCOM::LCOM1Data data1{};
+  LCOM::LCOM5Data data5{};
+  // Only set with --lcom:memory-columns.
+  bool hasMemory = false;
+  std::size_t approxBytes = 0;
+  std::size_t rssBytes = 0;
+  std::size_t peakRssBytes = 0;
+  // Only set for sinks that need it.
+  Detail detail;
+
+  // Normalized metrics.
+  double LCOM1Norm() const { return (double)LCOM1 / (double)data1.totalPairs; }
+  double LCOM2Norm() const { return (double)LCOM2 / (double)data1.totalPairs; }
+  double LCOM3Norm() const { return (double)LCOM3 / (double)data5.k; }
+  // NOTE: Normalized LCOM4 is basically YALCOM without special 0 and 1 cases.
+  // https://www.tusharma.in/yalcom-yet-another-lcom-metric.html
+  double LCOM4Norm() const { return (double)LCOM4 / (double)data5.k; }
+};
+
+// A file that only appears at its path once it is committed.
+class File {
+  const boost::filesystem::path path;
+  const boost::filesystem::path tempPath;
+  std::vector<char> buffer;
+  std::ofstream os;
+  bool committed = false;
+
+ public:
+  explicit File(const boost::filesystem::path& path)
+      : path(path),
+        tempPath(path.string() + ".tmp." + std::to_string(getpid())),
+        buffer(bufferBytes) {
+    // The buffer must be set before the file is opened to take effect.
+    os.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    os.open(tempPath.string(), std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+      LOG(ERROR) << "Unable to open " << tempPath << " for writing."
+                 << std::endl;
+  }
+  ~File() {
+    if (committed) return;
+    os.close();
+    boost::system::error_code ec;
+    boost::filesystem::remove(tempPath, ec);
+  }
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  std::ostream& Stream() { return os; }
+
+  // Flush the file and move it to its destination. Returns false on failure.
+  bool Commit() {
+    if (!os.is_open()) return false;
+    os.close();
+    if (os.fail()) {
+      LOG(ERROR) << "Unable to write " << tempPath << "." << std::endl;
+      return false;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+      LOG(ERROR) << "Unable to move " << tempPath << " to " << path << ": "
+                 << ec.message() << std::endl;
+      return false;
+    }
+    committed = true;
+    return true;
+  }
+};
+
+class Sink {
+ public:
+  virtual ~Sink() = default;
+  virtual void Write(const Row& row) = 0;
+  // Whether rows must carry their Detail.
+  virtual bool NeedsDetail() const { return false; }
+  // Finish the output. Returns false if it could not be saved.
+  virtual bool Close() = 0;
+};
+
+// Discards every row. Used when the output could not be created, so that the
+// metrics are still printed.
+class NullSink : public Sink {
+ public:
+  void Write(const Row&) override {}
+  bool Close() override { return true; }
+};
+
+// The CSV header. Must match header.csv.
+const std::string csvHeader =
+    "FilePath,ClassName,ClassType,DotBehavior,LCOM1,LCOM2,LCOM3,LCOM4,LCOM5,"
+    "sharedPairs,unsharedPairs,totalPairs,a,l,k,LCOM1Norm,LCOM2Norm,LCOM3Norm,"
+    "LCOM4Norm,";
+// Appended to the header with --lcom:memory-columns.
+const std::string csvMemoryHeader = "ApproxBytes,RSSBytes,PeakRSSBytes,";
+
+// Write one line of CSV, in the column order of header.csv, followed by the
+// memory columns if present.
+void WriteCSV(std::ostream& os, const Row& row) {
+  os << row.sourceFile << ",\"" << row.className << "\",\"" << row.classType
+     << "\",\"" << row.dotBehavior << "\",";
+  os << row.LCOM1 << "," << row.LCOM2 << "," << row.LCOM3 << "," << row.LCOM4
+     << "," << row.LCOM5 << ",";
+  os << row.data1.sharedPairs << "," << row.data1.unsharedPairs << ","
+     << row.data1.totalPairs << ",";
+  os << row.data5.a << "," << row.data5.l << "," << row.data5.k << ",";
+  os << row.LCOM1Norm() << "," << row.LCOM2Norm() << "," << row.LCOM3Norm()
+     << "," << row.LCOM4Norm() << ",";
+  if (row.hasMemory) {
+    os << row.approxBytes << "," << row.rssBytes << "," << row.peakRssBytes
+       << ",";
+  }
+  os << '\n';
+}
+
+// One line per class, without a header.
+class CSVSink : public Sink {
+  File file;
+
+ public:
+  explicit CSVSink(const boost::filesystem::path& path) : file(path) {}
+
+  void Write(const Row& row) override { WriteCSV(file.Stream(), row); }
+
+  bool Close() override { return file.Commit(); }
+};
+
+// A file that many concurrent processes append to.
+// Each Append is written with O_APPEND while holding an exclusive flock on the
+// file, so the data of different processes never interleaves. Whichever
+// process finds the file empty first writes the header.
+class SharedFile {
+  const boost::filesystem::path path;
+  int fd = -1;
+
+  bool WriteAll(const std::string& data) {
+    const char* p = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+      const ssize_t n = ::write(fd, p, left);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p += n;
+      left -= static_cast<std::size_t>(n);
+    }
+    return true;
+  }
+
+ public:
+  explicit SharedFile(const boost::filesystem::path& path) : path(path) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+      LOG(ERROR) << "Unable to open " << path << " for appending: "
+                 << std::strerror(errno) << std::endl;
+  }
+  ~SharedFile() { Close(); }
+  SharedFile(const SharedFile&) = delete;
+  SharedFile& operator=(const SharedFile&) = delete;
+
+  // Append data, preceded by the header if the file is still empty.
+  bool Append(const std::string& header, const std::string& data) {
+    if (fd < 0) return false;
+    while (flock(fd, LOCK_EX) != 0) {
+      if (errno != EINTR) {
+        LOG(ERROR) << "Unable to lock " << path << ": " << std::strerror(errno)
+                   << std::endl;
+        return false;
+      }
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0) ok = WriteAll(header);
+    if (ok) ok = WriteAll(data);
+    flock(fd, LOCK_UN);
+    if (!ok)
+      LOG(ERROR) << "Unable to append to " << path << ": "
+                 << std::strerror(errno) << std::endl;
+    return ok;
+  }
+
+  void Close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+};
+
+// Appends rows to a CSV file shared by many concurrent processes.
+// Rows are collected and appended in chunks, so the rows of different
+// processes never interleave.
+class SharedCSVSink : public Sink {
+  SharedFile file;
+  const std::string header;
+  std::stringstream rows;
+  std::size_t rowBytes = 0;
+  // Whether every append so far succeeded.
+  bool ok = true;
+
+  bool Append() {
+    ok = file.Append(header, rows.str()) && ok;
+    rows.str("");
+    rowBytes = 0;
+    return ok;
+  }
+
+ public:
+  SharedCSVSink(const boost::filesystem::path& path, const bool memoryColumns)
+      : file(path),
+        header(csvHeader + (memoryColumns ? csvMemoryHeader : "") + "\n") {}
+
+  void Write(const Row& row) override {
+    const auto before = rows.tellp();
+    WriteCSV(rows, row);
+    rowBytes += static_cast<std::size_t>(rows.tellp() - before);
+    if (rowBytes >= bufferBytes) Append();
+  }
+
+  // Always appends, so the header exists even if no class was found.
+  bool Close() override {
+    Append();
+    file.Close();
+    return ok;
+  }
+};
+
+// Columnar binary output, for result sets too large to load from CSV quickly.
+// script/lcom_columnar.py reads it and converts it back to CSV.
+//
+// All values are little-endian. A file starts with columnarMagic and a u32
+// version, followed by any number of row groups. Each run writes one row
+// group holding every row of its source file, so runs can append to a shared
+// file. A row group is laid out as:
+//   u64 the size of the rest of the row group, in bytes
+//   u32 the number of rows
+//   u32 the number of strings, then each string as a u32 length and its bytes
+//   u32 the number of columns, then for each column:
+//     u8  its ColumnType
+//     u32 the length of its name, then the name, as in header.csv
+//     one value per row, of the size given by its type
+// String columns hold indices into the row group's string table, so repeated
+// paths and class names are only stored once.
+const std::string columnarMagic("LCOMCOL", 8);
+constexpr std::uint32_t columnarVersion = 1;
+
+enum class ColumnType : std::uint8_t { String = 1, UInt64, Int32, Float64 };
+
+class ColumnarSink : public Sink {
+  struct Column {
+    std::string name;
+    ColumnType type;
+    std::string data;
+  };
+  std::vector<Column> columns;
+  std::uint32_t numRows = 0;
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, std::uint32_t> stringIds;
+
+  boost::optional<File> file;
+  boost::optional<SharedFile> shared;
+
+  // Values are written byte by byte, least significant first, so the file
+  // does not depend on the host byte order.
+  template <typename T>
+  static void Put(std::string& out, const T value) {
+    using Bits = std::conditional_t<
+        sizeof(T) == 8, std::uint64_t,
+        std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint8_t>>;
+    static_assert(sizeof(Bits) == sizeof(T), "Unsupported column value size");
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < sizeof(bits); i++) {
+      out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+  }
+  static void PutString(std::string& out, const std::string& s) {
+    Put<std::uint32_t>(out, s.size());
+    out += s;
+  }
+
+  std::uint32_t StringId(const std::string& s) {
+    const auto it = stringIds.emplace(s, strings.size());
+    if (it.second) strings.push_back(s);
+    return it.first->second;
+  }
+
+  void AddColumn(const std::string& name, const ColumnType type) {
+    columns.push_back(Column{name, type, std::string()});
+  }
+
+  // The first row determines the columns.
+  void AddColumns(const Row& row) {
+    std::stringstream names(csvHeader);
+    std::string name;
+    std::size_t i = 0;
+    while (std::getline(names, name, ',')) {
+      // FilePath, ClassName, ClassType and DotBehavior are strings, followed
+      // by the four integer metrics, LCOM5, the six integer counts and the
+      // four normalized metrics.
+      const ColumnType type = i < 4    ? ColumnType::String
+                              : i < 8  ? ColumnType::UInt64
+                              : i < 9  ? ColumnType::Float64
+                              : i < 15 ? ColumnType::Int32
+                                       : ColumnType::Float64;
+      AddColumn(name, type);
+      ++i;
+    }
+    if (row.hasMemory) {
+      AddColumn("ApproxBytes", ColumnType::UInt64);
+      AddColumn("RSSBytes", ColumnType::UInt64);
+      AddColumn("PeakRSSBytes", ColumnType::UInt64);
+    }
+  }
+
+  std::string RowGroup() {
+    std::string group;
+    Put<std::uint32_t>(group, numRows);
+    Put<std::uint32_t>(group, strings.size());
+    for (const auto& s : strings) PutString(group, s);
+    Put<std::uint32_t>(group, columns.size());
+    for (const auto& column : columns) {
+      Put<std::uint8_t>(group, static_cast<std::uint8_t>(column.type));
+      PutString(group, column.name);
+      group += column.data;
+    }
+    std::string out;
+    Put<std::uint64_t>(out, group.size());
+    return out + group;
+  }
+
+  static std::string FileHeader() {
+    std::string header = columnarMagic;
+    Put<std::uint32_t>(header, columnarVersion);
+    return header;
+  }
+
+ public:
+  // With shared set, the row group is appended to a file shared with other
+  // processes. Otherwise the file is replaced.
+  ColumnarSink(const boost::filesystem::path& path, const bool isShared) {
+    if (isShared) {
+      shared.emplace(path);
+    } else {
+      file.emplace(path);
+    }
+  }
+
+  void Write(const Row& row) override {
+    if (columns.empty()) AddColumns(row);
+    std::size_t i = 0;
+    const auto str = [&](const std::string& s) {
+      Put<std::uint32_t>(columns[i++].data, StringId(s));
+    };
+    const auto u64 = [&](const std::size_t v) {
+      Put<std::uint64_t>(columns[i++].data, v);
+    };
+    const auto i32 = [&](const int v) {
+      Put<std::int32_t>(columns[i++].data, v);
+    };
+    const auto f64 = [&](const double v) { Put<double>(columns[i++].data, v); };
+    str(row.sourceFile.string());
+    str(row.className);
+    str(row.classType);
+    str(row.dotBehavior);
+    u64(row.LCOM1);
+    u64(row.LCOM2);
+    u64(row.LCOM3);
+    u64(row.LCOM4);
+    f64(row.LCOM5);
+    i32(row.data1.sharedPairs);
+    i32(row.data1.unsharedPairs);
+    i32(row.data1.totalPairs);
+    i32(row.data5.a);
+    i32(row.data5.l);
+    i32(row.data5.k);
+    f64(row.LCOM1Norm());
+    f64(row.LCOM2Norm());
+    f64(row.LCOM3Norm());
+    f64(row.LCOM4Norm());
+    if (row.hasMemory) {
+      u64(row.approxBytes);
+      u64(row.rssBytes);
+      u64(row.peakRssBytes);
+    }
+    ++numRows;
+  }
+
+  bool Close() override {
+    // Appending an empty row group would only add noise to a shared file.
+    if (shared) {
+      const bool ok = numRows == 0 || shared->Append(FileHeader(), RowGroup());
+      shared->Close();
+      return ok;
+    }
+    file->Stream() << FileHeader();
+    if (numRows > 0) file->Stream() << RowGroup();
+    return file->Commit();
+  }
+};
+
+// JSON Lines output, with the graph of each class next to its metrics.
+// Every class becomes one object on its own line:
+//   {"file": ..., "class": ..., "classType": ..., "dotBehavior": ...,
+//    "metrics": {"LCOM1": ..., ..., "LCOM4Norm": ...},
+//    "methods": [{"name": ..., "component": ...}, ...],
+//    "attributes": [["Class", "member", ...], ...],
+//    "accesses": [[method, attribute], ...],
+//    "calls": [[caller, callee], ...]}
+// Metrics are named as in header.csv, and undefined normalized metrics are
+// null. Lines are streamed out as classes finish, so they can be appended to
+// a shared file like CSV rows.
+class JSONLSink : public Sink {
+  boost::optional<File> file;
+  boost::optional<SharedFile> shared;
+  std::stringstream lines;
+  std::size_t lineBytes = 0;
+  // Whether every append so far succeeded.
+  bool ok = true;
+
+  static void WriteString(std::ostream& os, const std::string& s) {
+    os << '"' << Trace::JSONEscape(s) << '"';
+  }
+
+  static void WriteDouble(std::ostream& os, const double d) {
+    if (std::isfinite(d)) {
+      os << d;
+    } else {
+      os << "null";
+    }
+  }
+
+  template <typename T>
+  static void WritePairs(std::ostream& os, const T& pairs) {
+    os << '[';
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+      if (i > 0) os << ',';
+      os << '[' << pairs[i].first << ',' << pairs[i].second << ']';
+    }
+    os << ']';
+  }
+
+  static void WriteLine(std::ostream& os, const Row& row) {
+    os << "{\"file\":";
+    WriteString(os, row.sourceFile.string());
+    os << ",\"class\":";
+    WriteString(os, row.className);
+    os << ",\"classType\":";
+    WriteString(os, row.classType);
+    os << ",\"dotBehavior\":";
+    WriteString(os, row.dotBehavior);
+    os << ",\"metrics\":{\"LCOM1\":" << row.LCOM1 << ",\"LCOM2\":" << row.LCOM2
+       << ",\"LCOM3\":" << row.LCOM3 << ",\"LCOM4\":" << row.LCOM4
+       << ",\"LCOM5\":";
+    WriteDouble(os, row.LCOM5);
+    os << ",\"sharedPairs\":" << row.data1.sharedPairs
+       << ",\"unsharedPairs\":" << row.data1.unsharedPairs
+       << ",\"totalPairs\":" << row.data1.totalPairs << ",\"a\":" << row.data5.a
+       << ",\"l\":" << row.data5.l << ",\"k\":" << row.data5.k;
+    os << ",\"LCOM1Norm\":";
+    WriteDouble(os, row.LCOM1Norm());
+    os << ",\"LCOM2Norm\":";
+    WriteDouble(os, row.LCOM2Norm());
+    os << ",\"LCOM3Norm\":";
+    WriteDouble(os, row.LCOM3Norm());
+    os << ",\"LCOM4Norm\":";
+    WriteDouble(os, row.LCOM4Norm());
+    if (row.hasMemory) {
+      os << ",\"ApproxBytes\":" << row.approxBytes
+         << ",\"RSSBytes\":" << row.rssBytes
+         << ",\"PeakRSSBytes\":" << row.peakRssBytes;
+    }
+    os << "},\"methods\":[";
+    const Detail& detail = row.detail;
+    for (std::size_t i = 0; i < detail.methods.size(); ++i) {
+      if (i > 0) os << ',';
+      os << "{\"name\":";
+      WriteString(os, detail.methods[i]);
+      os << ",\"component\":" << detail.components[i] << '}';
+    }
+    os << "],\"attributes\":[";
+    for (std::size_t i = 0; i < detail.attributes.size(); ++i) {
+      if (i > 0) os << ',';
+      os << '[';
+      for (std::size_t j = 0; j < detail.attributes[i].size(); ++j) {
+        if (j > 0) os << ',';
+        WriteString(os, detail.attributes[i][j]);
+      }
+      os << ']';
+    }
+    os << "],\"accesses\":";
+    WritePairs(os, detail.accesses);
+    os << ",\"calls\":";
+    WritePairs(os, detail.calls);
+    os << "}\n";
+  }
+
+  bool Append() {
+    ok = shared->Append("", lines.str()) && ok;
+    lines.str("");
+    lineBytes = 0;
+    return ok;
+  }
+
+ public:
+  // With shared set, lines are appended to a file shared with other
+  // processes, in chunks so the lines of different processes never
+  // interleave. Otherwise the file is replaced.
+  JSONLSink(const boost::filesystem::path& path, const bool isShared) {
+    if (isShared) {
+      shared.emplace(path);
+    } else {
+      file.emplace(path);
+    }
+  }
+
+  bool NeedsDetail() const override { return true; }
+
+  void Write(const Row& row) override {
+    if (file) {
+      WriteLine(file->Stream(), row);
+      return;
+    }
+    const auto before = lines.tellp();
+    WriteLine(lines, row);
+    lineBytes += static_cast<std::size_t>(lines.tellp() - before);
+    if (lineBytes >= bufferBytes) Append();
+  }
+
+  bool Close() override {
+    if (shared) {
+      if (lineBytes > 0) Append();
+      shared->Close();
+      return ok;
+    }
+    return file->Commit();
+  }
+};
+
+// The encoding of the metrics output.
+enum class Format { CSV, Columnar, JSONL };
+
+// The extension of the default output file of each format.
+std::string Extension(const Format format) {
+  switch (format) {
+    case Format::Columnar:
+      return ".lcomcol";
+    case Format::JSONL:
+      return ".jsonl";
+    case Format::CSV:
+      break;
+  }
+  return ".csv";
+}
+
+// The outputs named by --lcom:outputs.
+struct Selection {
+  bool metrics = false;
+  // The metrics format, if one was named instead of "metrics".
+  boost::optional<Format> format;
+  bool dot = false;
+};
+
+// Parse a comma-separated list of outputs. Only one metrics encoding can be
+// written per run, as they all share --lcom:csv-output. Returns false, after
+// logging the reason, if a name is unknown or several formats are given.
+bool ParseOutputs(const std::string& names, Selection& selection) {
+  selection = Selection();
+  std::stringstream list(names);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    boost::optional<Format> format;
+    if (name == "metrics") {
+      selection.metrics = true;
+    } else if (name == "csv") {
+      format = Format::CSV;
+    } else if (name == "columnar") {
+      format = Format::Columnar;
+    } else if (name == "jsonl") {
+      format = Format::JSONL;
+    } else if (name == "dot") {
+      selection.dot = true;
+    } else {
+      LOG(ERROR) << "Unknown output \"" << name
+                 << "\" in --lcom:outputs. Expected metrics, csv, columnar, "
+                    "jsonl or dot."
+                 << std::endl;
+      return false;
+    }
+    if (!format) continue;
+    if (selection.format && *selection.format != *format) {
+      LOG(ERROR) << "Only one metrics format can be written per run, but "
+                    "--lcom:outputs names several: \""
+                 << names << "\"." << std::endl;
+      return false;
+    }
+    selection.metrics = true;
+    selection.format = format;
+  }
+  return true;
+}
+
+}  // namespace Output
+
+#endif  // OUTPUT_HPP
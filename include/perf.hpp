@@ -0,0 +1,169 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+// Hardware performance counters via Linux perf_event_open.
+// The profiler reads these at the start and end of each phase when
+// --lcom:perf-counters is given. If the kernel refuses to open the counters
+// (e.g. due to perf_event_paranoid, containers or missing PMU support), a
+// warning is logged once and phases are profiled without them.
+// This header does not depend on ROSE.
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "aixlog.hpp"
+
+namespace Perf {
+
+// Whether hardware counters were requested.
+bool requested = false;
+
+constexpr std::size_t numEvents = 4;
+const std::array<const char*, numEvents> eventNames = {
+    "instructions", "cycles", "cacheMisses", "branchMisses"};
+const std::array<std::uint64_t, numEvents> eventConfigs = {
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+// Counter values, in the order of eventNames, with the time the counters were
+// enabled and actually counting. Samples returned by Counters::Read() hold the
+// raw cumulative counts. Deltas between two samples are scaled for
+// multiplexing, see operator-.
+struct Sample {
+  bool valid = false;
+  std::array<std::uint64_t, numEvents> values{};
+  std::uint64_t timeEnabled = 0;
+  std::uint64_t timeRunning = 0;
+
+  Sample& operator+=(const Sample& other) {
+    valid = valid || other.valid;
+    for (std::size_t i = 0; i < numEvents; ++i) values[i] += other.values[i];
+    timeEnabled += other.timeEnabled;
+    timeRunning += other.timeRunning;
+    return *this;
+  }
+};
+
+// The counter values accumulated between two raw samples.
+// If the kernel had to multiplex the counters, they only counted for part of
+// the interval, so the raw delta is scaled up by the ratio of the time enabled
+// to the time running within that interval. Scaling each cumulative sample
+// separately instead would use two different ratios, and the scaled end could
+// then be smaller than the scaled start.
+Sample operator-(const Sample& end, const Sample& start) {
+  Sample delta;
+  if (!end.valid || !start.valid) return delta;
+  delta.valid = true;
+  delta.timeEnabled = end.timeEnabled - start.timeEnabled;
+  delta.timeRunning = end.timeRunning - start.timeRunning;
+  const double scale =
+      delta.timeRunning > 0 && delta.timeRunning < delta.timeEnabled
+          ? static_cast<double>(delta.timeEnabled) / delta.timeRunning
+          : 1.0;
+  for (std::size_t i = 0; i < numEvents; ++i) {
+    // The raw counts only grow, but guard against a reset counter.
+    const std::uint64_t raw = end.values[i] >= start.values[i]
+                                  ? end.values[i] - start.values[i]
+                                  : 0;
+    delta.values[i] = static_cast<std::uint64_t>(raw * scale);
+  }
+  return delta;
+}
+
+// A group of counters for this process, opened on first use.
+class Counters {
+  static Counters instance;
+  Counters() {}
+
+  int leader = -1;
+  std::array<int, numEvents> fds{};
+  bool tried = false;
+
+  static int Open(std::uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+  }
+
+  void Close() {
+    for (int& fd : fds) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+    }
+    leader = -1;
+  }
+
+  // Open all counters as one group so they are scheduled together.
+  bool OpenGroup() {
+    tried = true;
+    fds.fill(-1);
+    for (std::size_t i = 0; i < numEvents; ++i) {
+      fds[i] = Open(eventConfigs[i], leader);
+      if (fds[i] < 0) {
+        LOG(WARNING) << "Unable to open the " << eventNames[i]
+                     << " hardware counter (" << std::strerror(errno)
+                     << "). Profiling without hardware counters." << std::endl;
+        Close();
+        return false;
+      }
+      if (i == 0) leader = fds[0];
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+  }
+
+ public:
+  static Counters& inst() { return instance; }
+  ~Counters() { Close(); }
+
+  // Read the current raw counter values. The returned sample is invalid if the
+  // counters are unavailable.
+  Sample Read() {
+    Sample sample;
+    if (!requested) return sample;
+    if (!tried) OpenGroup();
+    if (leader < 0) return sample;
+
+    // Layout for PERF_FORMAT_GROUP with both time fields.
+    struct {
+      std::uint64_t nr;
+      std::uint64_t timeEnabled;
+      std::uint64_t timeRunning;
+      std::uint64_t values[numEvents];
+    } data;
+    if (read(leader, &data, sizeof(data)) != sizeof(data) ||
+        data.nr != numEvents) {
+      return sample;
+    }
+    sample.valid = true;
+    sample.timeEnabled = data.timeEnabled;
+    sample.timeRunning = data.timeRunning;
+    for (std::size_t i = 0; i < numEvents; ++i) {
+      sample.values[i] = data.values[i];
+    }
+    return sample;
+  }
+};
+Counters Counters::instance;
+
+}  // namespace Perf
+
+#endif  // PERF_HPP
@@ -0,0 +1,300 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+// Phase-level timing instrumentation.
+// Wrap a pipeline phase in a Profile::Scope to record its monotonic wall time
+// and process CPU time. When a profile path is set (--lcom:profile), all
+// recorded phases are written out as JSON at the end of the run.
+// Every scope is also recorded as a trace span when tracing is enabled.
+// Each phase also records the resident set size (RSS) once it ends, and the
+// approximate size of the main data structures can be recorded with
+// AddMemory().
+// With --lcom:perf-counters, phases also record hardware counters.
+// This header does not depend on ROSE.
+
+#include <time.h>
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "aixlog.hpp"
+#include "perf.hpp"
+#include "trace.hpp"
+
+namespace Profile {
+
+// Where to write the profile. Profiling is disabled while this is empty.
+std::string outputPath;
+
+bool Enabled() { return !outputPath.empty(); }
+
+// A single timed phase.
+struct Phase {
+  std::string name;
+  // The class type being analyzed, if any.
+  std::string classType;
+  // The class being analyzed, if any.
+  std::string className;
+  // Start time, relative to the start of the run.
+  double startSeconds = 0;
+  double wallSeconds = 0;
+  double cpuSeconds = 0;
+  // Current and peak RSS once the phase ended.
+  std::size_t rssBytes = 0;
+  std::size_t peakRssBytes = 0;
+  // Hardware counters accumulated during the phase, if available.
+  Perf::Sample perf;
+};
+
+// The approximate size of a data structure.
+struct Memory {
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+};
+
+class Profiler {
+  static Profiler instance;
+  Profiler() : start(std::chrono::steady_clock::now()) {}
+
+ public:
+  static Profiler& inst() { return instance; }
+
+  const std::chrono::steady_clock::time_point start;
+  // General information about the run, such as the analyzed file.
+  std::map<std::string, std::string> info;
+  // Named counts, such as the number of AST nodes or classes.
+  std::map<std::string, std::size_t> counts;
+  // Named data structure sizes, such as the class data maps.
+  std::map<std::string, Memory> memory;
+  std::vector<Phase> phases;
+
+  double SecondsSinceStart() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  }
+};
+Profiler Profiler::instance;
+
+// CPU time consumed by the whole process, in seconds.
+double CPUSeconds() {
+  timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The resident set size of the process, in bytes.
+struct RSS {
+  std::size_t current = 0;
+  std::size_t peak = 0;
+};
+
+// Read the current (VmRSS) and peak (VmHWM) RSS from /proc/self/status.
+// Both are zero where that file is unavailable.
+RSS ReadRSS() {
+  RSS rss;
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    std::size_t* field = nullptr;
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      field = &rss.current;
+    } else if (line.compare(0, 6, "VmHWM:") == 0) {
+      field = &rss.peak;
+    } else {
+      continue;
+    }
+    // The values are reported in kB.
+    std::stringstream ss(line.substr(6));
+    std::size_t kb = 0;
+    ss >> kb;
+    *field = kb * 1024;
+  }
+  return rss;
+}
+
+// Records the phase it is constructed in until it is destroyed.
+class Scope {
+  Trace::Span span;
+  Phase phase;
+  double cpuStart = 0;
+  std::chrono::steady_clock::time_point wallStart;
+  Perf::Sample perfStart;
+
+ public:
+  Scope(const std::string& name, const std::string& classType = "",
+        const std::string& className = "")
+      : span(name, classType, className) {
+    if (!Enabled()) return;
+    phase.name = name;
+    phase.classType = classType;
+    phase.className = className;
+    phase.startSeconds = Profiler::inst().SecondsSinceStart();
+    cpuStart = CPUSeconds();
+    wallStart = std::chrono::steady_clock::now();
+    perfStart = Perf::Counters::inst().Read();
+  }
+  ~Scope() {
+    if (!Enabled()) return;
+    phase.perf = Perf::Counters::inst().Read() - perfStart;
+    phase.wallSeconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - wallStart)
+                            .count();
+    phase.cpuSeconds = CPUSeconds() - cpuStart;
+    const RSS rss = ReadRSS();
+    phase.rssBytes = rss.current;
+    phase.peakRssBytes = rss.peak;
+    Profiler::inst().phases.push_back(phase);
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+// Record any streamable value as general information about the run.
+template <typename T>
+void SetInfo(const std::string& key, const T& value) {
+  if (!Enabled()) return;
+  std::stringstream ss;
+  ss << value;
+  Profiler::inst().info[key] = ss.str();
+}
+
+void AddCount(const std::string& key, std::size_t count) {
+  if (!Enabled()) return;
+  Profiler::inst().counts[key] += count;
+}
+
+// Record the approximate size of a data structure.
+void AddMemory(const std::string& key, std::size_t count, std::size_t bytes) {
+  if (!Enabled()) return;
+  Memory& memory = Profiler::inst().memory[key];
+  memory.count += count;
+  memory.bytes += bytes;
+}
+
+// Approximate per-node overhead of a node-based container like std::map or
+// std::set: the node color and the parent, left and right pointers.
+constexpr std::size_t nodeOverhead = 4 * sizeof(void*);
+
+// Approximate heap bytes held by the nodes of a node-based container, not
+// counting anything the elements themselves own.
+template <typename M>
+std::size_t NodeBytes(const M& m) {
+  return m.size() * (sizeof(typename M::value_type) + nodeOverhead);
+}
+
+// Write all recorded data as JSON.
+// Per-phase totals are included so dashboards don't need to aggregate the
+// individual phases themselves.
+void Write() {
+  if (!Enabled()) return;
+  const Profiler& prof = Profiler::inst();
+
+  struct Total {
+    std::size_t count = 0;
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+  };
+  std::map<std::string, Total> totals;
+  // Hardware counters per phase and class type.
+  std::map<std::string, Perf::Sample> perfTotals;
+  for (const auto& phase : prof.phases) {
+    Total& total = totals[phase.name];
+    total.count++;
+    total.wallSeconds += phase.wallSeconds;
+    total.cpuSeconds += phase.cpuSeconds;
+    if (phase.perf.valid) {
+      const std::string key = phase.classType.empty()
+                                  ? phase.name
+                                  : phase.classType + ":" + phase.name;
+      perfTotals[key] += phase.perf;
+    }
+  }
+
+  std::ofstream os(outputPath);
+  if (!os.is_open()) {
+    LOG(ERROR) << "Unable to open " << outputPath << " to write the profile."
+               << std::endl;
+    return;
+  }
+  // Write the counters of a sample as JSON members.
+  const auto writePerf = [&os](const Perf::Sample& sample) {
+    for (std::size_t i = 0; i < Perf::numEvents; ++i) {
+      os << (i == 0 ? "" : ", ") << "\"" << Perf::eventNames[i]
+         << "\": " << sample.values[i];
+    }
+  };
+  os << std::setprecision(9);
+  os << "{" << std::endl;
+  os << "  \"info\": {";
+  for (auto it = prof.info.cbegin(); it != prof.info.cend(); ++it) {
+    os << (it == prof.info.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape(it->first) << "\": \""
+       << Trace::JSONEscape(it->second) << "\"";
+  }
+  os << std::endl << "  }," << std::endl;
+  os << "  \"counts\": {";
+  for (auto it = prof.counts.cbegin(); it != prof.counts.cend(); ++it) {
+    os << (it == prof.counts.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape(it->first) << "\": " << it->second;
+  }
+  os << std::endl << "  }," << std::endl;
+  os << "  \"memory\": {";
+  for (auto it = prof.memory.cbegin(); it != prof.memory.cend(); ++it) {
+    os << (it == prof.memory.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape(it->first) << "\": {\"count\": "
+       << it->second.count << ", \"approxBytes\": " << it->second.bytes << "}";
+  }
+  const RSS rss = ReadRSS();
+  os << std::endl << "  }," << std::endl;
+  os << "  \"rssBytes\": " << rss.current << "," << std::endl;
+  os << "  \"peakRssBytes\": " << rss.peak << "," << std::endl;
+  os << "  \"totals\": {";
+  for (auto it = totals.cbegin(); it != totals.cend(); ++it) {
+    os << (it == totals.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape(it->first) << "\": {\"count\": "
+       << it->second.count << ", \"wallSeconds\": " << it->second.wallSeconds
+       << ", \"cpuSeconds\": " << it->second.cpuSeconds << "}";
+  }
+  os << std::endl << "  }," << std::endl;
+  os << "  \"hardwareCounters\": {";
+  for (auto it = perfTotals.cbegin(); it != perfTotals.cend(); ++it) {
+    os << (it == perfTotals.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape(it->first) << "\": {";
+    writePerf(it->second);
+    os << "}";
+  }
+  os << std::endl << "  }," << std::endl;
+  os << "  \"phases\": [";
+  for (auto it = prof.phases.cbegin(); it != prof.phases.cend(); ++it) {
+    os << (it == prof.phases.cbegin() ? "" : ",") << std::endl;
+    os << "    {\"name\": \"" << Trace::JSONEscape(it->name) << "\"";
+    if (!it->classType.empty())
+      os << ", \"classType\": \"" << Trace::JSONEscape(it->classType) << "\"";
+    if (!it->className.empty())
+      os << ", \"class\": \"" << Trace::JSONEscape(it->className) << "\"";
+    os << ", \"startSeconds\": " << it->startSeconds
+       << ", \"wallSeconds\": " << it->wallSeconds
+       << ", \"cpuSeconds\": " << it->cpuSeconds
+       << ", \"rssBytes\": " << it->rssBytes
+       << ", \"peakRssBytes\": " << it->peakRssBytes;
+    if (it->perf.valid) {
+      os << ", ";
+      writePerf(it->perf);
+    }
+    os << "}";
+  }
+  os << std::endl << "  ]" << std::endl;
+  os << "}" << std::endl;
+  LOG(INFO) << "Saved profile to " << outputPath << std::endl;
+}
+
+}  // namespace Profile
+
+#endif  // PROFILE_HPP
@@ -0,0 +1,199 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// Hot-path counters.
+// The counters are always compiled in, but only count when --lcom:stats is
+// passed, at the cost of a single branch each. They show which inputs trigger
+// expensive paths, such as deep expression unwrapping or quadratic pair
+// comparisons, without attaching a profiler.
+// This header does not depend on ROSE.
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "asynclog.hpp"
+#include "trace.hpp"
+
+namespace Stats {
+
+enum class Format { None, Table, JSON };
+
+// How to print the counters. Counting is disabled while this is None.
+Format format = Format::None;
+
+bool Enabled() { return format != Format::None; }
+
+// A monotonically increasing count of events.
+class Counter {
+ public:
+  const std::string name;
+  std::size_t value = 0;
+
+  explicit Counter(std::string name);
+  void Add(std::size_t n = 1) {
+    if (Enabled()) value += n;
+  }
+};
+
+// Tracks how often a recursive function is entered and how deep it recurses.
+class Depth {
+ public:
+  const std::string name;
+  std::size_t calls = 0;
+  std::size_t max = 0;
+  std::size_t current = 0;
+
+  explicit Depth(std::string name);
+
+  // Counts one level of recursion for as long as it is alive.
+  class Guard {
+    Depth& depth;
+    const bool active;
+
+   public:
+    explicit Guard(Depth& depth) : depth(depth), active(Enabled()) {
+      if (!active) return;
+      depth.calls++;
+      depth.max = std::max(depth.max, ++depth.current);
+    }
+    ~Guard() {
+      if (active) depth.current--;
+    }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+  };
+};
+
+// Counts events per small integer key, such as a node variant.
+class Histogram {
+ public:
+  const std::string name;
+  std::vector<std::size_t> counts;
+  // Converts a key into a printable label.
+  std::string (*label)(std::size_t);
+
+  Histogram(std::string name, std::string (*label)(std::size_t));
+  void Add(std::size_t key) {
+    if (!Enabled()) return;
+    if (key >= counts.size()) counts.resize(key + 1);
+    counts[key]++;
+  }
+};
+
+// All counters, in order of construction.
+class Registry {
+  static Registry instance;
+  Registry() {}
+
+ public:
+  static Registry& inst() { return instance; }
+
+  std::vector<const Counter*> counters;
+  std::vector<const Depth*> depths;
+  std::vector<const Histogram*> histograms;
+};
+// Counters are constructed as globals in headers that include this one, so
+// the registry is always initialized before them.
+Registry Registry::instance;
+
+Counter::Counter(std::string name) : name(std::move(name)) {
+  Registry::inst().counters.push_back(this);
+}
+Depth::Depth(std::string name) : name(std::move(name)) {
+  Registry::inst().depths.push_back(this);
+}
+Histogram::Histogram(std::string name, std::string (*label)(std::size_t))
+    : name(std::move(name)), label(label) {
+  Registry::inst().histograms.push_back(this);
+}
+
+// The non-zero entries of a histogram, from most to least frequent.
+std::vector<std::pair<std::string, std::size_t>> SortedEntries(
+    const Histogram& h) {
+  std::vector<std::pair<std::string, std::size_t>> entries;
+  for (std::size_t key = 0; key < h.counts.size(); ++key) {
+    if (h.counts[key] != 0) entries.emplace_back(h.label(key), h.counts[key]);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.second > b.second;
+                   });
+  return entries;
+}
+
+void PrintTable(std::ostream& os) {
+  const Registry& reg = Registry::inst();
+  os << "Counters:" << std::endl;
+  for (const Counter* c : reg.counters) {
+    os << "  " << std::left << std::setw(48) << c->name << std::right
+       << std::setw(14) << c->value << std::endl;
+  }
+  os << "Recursion:" << std::endl;
+  for (const Depth* d : reg.depths) {
+    os << "  " << std::left << std::setw(48) << d->name << std::right
+       << std::setw(14) << d->calls << " calls, max depth " << d->max
+       << std::endl;
+  }
+  for (const Histogram* h : reg.histograms) {
+    os << h->name << ":" << std::endl;
+    for (const auto& entry : SortedEntries(*h)) {
+      os << "  " << std::left << std::setw(48) << entry.first << std::right
+         << std::setw(14) << entry.second << std::endl;
+    }
+  }
+}
+
+void PrintJSON(std::ostream& os) {
+  const Registry& reg = Registry::inst();
+  os << "{" << std::endl << "  \"counters\": {";
+  for (auto it = reg.counters.cbegin(); it != reg.counters.cend(); ++it) {
+    os << (it == reg.counters.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape((*it)->name) << "\": " << (*it)->value;
+  }
+  os << std::endl << "  }," << std::endl << "  \"recursion\": {";
+  for (auto it = reg.depths.cbegin(); it != reg.depths.cend(); ++it) {
+    os << (it == reg.depths.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape((*it)->name)
+       << "\": {\"calls\": " << (*it)->calls << ", \"maxDepth\": " << (*it)->max
+       << "}";
+  }
+  os << std::endl << "  }," << std::endl << "  \"histograms\": {";
+  for (auto it = reg.histograms.cbegin(); it != reg.histograms.cend(); ++it) {
+    os << (it == reg.histograms.cbegin() ? "" : ",") << std::endl;
+    os << "    \"" << Trace::JSONEscape((*it)->name) << "\": {";
+    const auto entries = SortedEntries(**it);
+    for (auto e = entries.cbegin(); e != entries.cend(); ++e) {
+      os << (e == entries.cbegin() ? "" : ", ") << "\""
+         << Trace::JSONEscape(e->first) << "\": " << e->second;
+    }
+    os << "}";
+  }
+  os << std::endl << "  }" << std::endl << "}" << std::endl;
+}
+
+// Print all counters in the requested format.
+void Print(std::ostream& os = std::cout) {
+  if (format == Format::None) return;
+  // Keep the counters in order with log messages on standard output.
+  AsyncLog::Sync();
+  switch (format) {
+    case Format::None:
+      break;
+    case Format::Table:
+      PrintTable(os);
+      break;
+    case Format::JSON:
+      PrintJSON(os);
+      break;
+  }
+  os.flush();
+}
+
+}  // namespace Stats
+
+#endif  // STATS_HPP
@@ -0,0 +1,188 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Chrome/Perfetto trace-event recorder.
+// Wrap a region in a Trace::Span to record it as a complete ("X") event. When
+// a trace path is set (--lcom:trace), all recorded events are written out as
+// traceEvents JSON at the end of the run, which can be opened with
+// chrome://tracing or https://ui.perfetto.dev.
+// Each thread appends to its own buffer, so recording never takes a lock.
+// This header does not depend on ROSE.
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "aixlog.hpp"
+
+namespace Trace {
+
+// Where to write the trace. Tracing is disabled while this is empty.
+std::string outputPath;
+
+bool Enabled() { return !outputPath.empty(); }
+
+// A single complete event.
+struct Event {
+  std::string name;
+  // The category, used here for the class type being analyzed.
+  std::string category;
+  // The class being analyzed, if any.
+  std::string className;
+  // Start time and duration, in microseconds.
+  double ts = 0;
+  double dur = 0;
+};
+
+// Events recorded by a single thread.
+// Buffers are only ever appended to by their owning thread, and are linked
+// into a global list once on creation with a compare-and-swap.
+struct Buffer {
+  std::uint32_t tid = 0;
+  std::vector<Event> events;
+  Buffer* next = nullptr;
+};
+
+class Recorder {
+  static Recorder instance;
+  Recorder() : start(std::chrono::steady_clock::now()) {}
+
+ public:
+  static Recorder& inst() { return instance; }
+
+  const std::chrono::steady_clock::time_point start;
+  std::atomic<Buffer*> head{nullptr};
+  std::atomic<std::uint32_t> nextTid{1};
+
+  double MicrosecondsSinceStart() const {
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  // Get the calling thread's buffer, creating and registering it if needed.
+  // Buffers live until the end of the process so they can be written out
+  // after their threads have finished.
+  Buffer& ThreadBuffer() {
+    thread_local Buffer* buffer = nullptr;
+    if (buffer == nullptr) {
+      buffer = new Buffer();
+      buffer->tid = nextTid++;
+      buffer->events.reserve(1024);
+      buffer->next = head.load(std::memory_order_relaxed);
+      while (!head.compare_exchange_weak(buffer->next, buffer,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+      }
+    }
+    return *buffer;
+  }
+};
+Recorder Recorder::instance;
+
+// Records the region it is constructed in until it is destroyed.
+class Span {
+  Event event;
+  bool active = false;
+
+ public:
+  Span(const std::string& name, const std::string& category = "",
+       const std::string& className = "") {
+    if (!Enabled()) return;
+    active = true;
+    event.name = name;
+    event.category = category;
+    event.className = className;
+    event.ts = Recorder::inst().MicrosecondsSinceStart();
+  }
+  ~Span() {
+    if (!active) return;
+    event.dur = Recorder::inst().MicrosecondsSinceStart() - event.ts;
+    Recorder::inst().ThreadBuffer().events.push_back(std::move(event));
+  }
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+};
+
+// Escape a string for use in JSON.
+std::string JSONEscape(const std::string& s) {
+  std::stringstream ss;
+  for (const char c : s) {
+    switch (c) {
+      case '"':
+        ss << "\\\"";
+        break;
+      case '\\':
+        ss << "\\\\";
+        break;
+      case '\n':
+        ss << "\\n";
+        break;
+      case '\t':
+        ss << "\\t";
+        break;
+      case '\r':
+        ss << "\\r";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(c) << std::dec;
+        } else {
+          ss << c;
+        }
+    }
+  }
+  return ss.str();
+}
+
+// Write all recorded events as traceEvents JSON.
+// Must only be called once every traced thread has finished.
+void Write() {
+  if (!Enabled()) return;
+  std::ofstream os(outputPath);
+  if (!os.is_open()) {
+    LOG(ERROR) << "Unable to open " << outputPath << " to write the trace."
+               << std::endl;
+    return;
+  }
+  const int pid = getpid();
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for (const Buffer* buffer =
+           Recorder::inst().head.load(std::memory_order_acquire);
+       buffer != nullptr; buffer = buffer->next) {
+    os << (first ? "" : ",") << std::endl;
+    first = false;
+    os << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+       << ", \"tid\": " << buffer->tid
+       << ", \"args\": {\"name\": \"lcom-" << buffer->tid << "\"}}";
+    for (const auto& event : buffer->events) {
+      os << "," << std::endl;
+      os << "  {\"name\": \"" << JSONEscape(event.name) << "\"";
+      if (!event.category.empty())
+        os << ", \"cat\": \"" << JSONEscape(event.category) << "\"";
+      os << ", \"ph\": \"X\", \"ts\": " << event.ts
+         << ", \"dur\": " << event.dur << ", \"pid\": " << pid
+         << ", \"tid\": " << buffer->tid;
+      if (!event.className.empty())
+        os << ", \"args\": {\"class\": \"" << JSONEscape(event.className)
+           << "\"}";
+      os << "}";
+    }
+  }
+  os << std::endl << "]}" << std::endl;
+  LOG(INFO) << "Saved trace to " << outputPath << std::endl;
+}
+
+}  // namespace Trace
+
+#endif  // TRACE_HPP
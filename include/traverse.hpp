@@ -8,18 +8,27 @@
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 #include <exception>
+#include <initializer_list>
+#include <iterator>
+#include <set>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "aixlog.hpp"
+#include "anonymize.hpp"
 #include "define.hpp"
 #include "is-type-rose.hpp"
 #include "lcom.hpp"
 #include "node-print.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "variant-table.hpp"
 #include "sageInterfaceAda.h"
 
 namespace Traverse {
@@ -28,6 +37,23 @@ namespace Traverse {
 // hack to make it work everywhere.
 boost::filesystem::path sourceFile = boost::filesystem::path("./NoFile");
 
+// Hot-path counters for the extraction, printed by --lcom:stats.
+std::string VariantLabel(std::size_t v) {
+  return getVariantName(static_cast<VariantT>(v));
+}
+Stats::Histogram renamingVisits("Renaming traversal visits per variant",
+                                VariantLabel);
+Stats::Histogram visitorVisits("Visitor traversal visits per variant",
+                               VariantLabel);
+Stats::Counter scopeRecurseSteps("GetScopeRecurse steps");
+Stats::Depth rootExpDepth("GetRootExp");
+Stats::Counter attributeAliasHits("HandleSgVarRefExp attributeAliasMap hits");
+Stats::Counter attributeAliasMisses(
+    "HandleSgVarRefExp attributeAliasMap misses");
+Stats::Counter methodAliasHits("HandleSgVarRefExp cStyleMethodAliasMap hits");
+Stats::Counter methodAliasMisses(
+    "HandleSgVarRefExp cStyleMethodAliasMap misses");
+
 // Forward declarations.
 template <typename C>
 class Class;
@@ -192,12 +218,75 @@ bool compareVectors(std::vector<T> a, std::vector<T> b) {
   return (a == b);
 }
 
+// What IsInSourceRoots has worked out so far. File IDs are only meaningful
+// within one project, and sourceRoots may change between extractions, so this
+// is part of the extraction state and is dropped along with the IA maps.
+struct SourceRootCache {
+  // The normalized sourceRoots, set on first use.
+  boost::optional<std::vector<boost::filesystem::path>> roots;
+  // Whether each file, by ID, lies within the roots.
+  std::unordered_map<int, bool> files;
+};
+SourceRootCache sourceRootCache;
+
+// Forget the normalized roots and the files checked against them.
+void ClearSourceRoots() { sourceRootCache = SourceRootCache(); }
+
+// Check whether a node is located within one of the sourceRoots.
+// Nodes without a real file location (e.g., compiler-generated nodes) are
+// always accepted. If no roots are set, every node is accepted.
+bool IsInSourceRoots(SgNode* n) {
+  if (sourceRoots.empty()) return true;
+  SgLocatedNode* ln = is<SgLocatedNode>(n);
+  if (!ln) return true;
+  Sg_File_Info* fi = ln->get_file_info();
+  if (!fi || fi->isCompilerGenerated() || fi->isTransformation() ||
+      fi->isFrontendSpecific())
+    return true;
+
+  // Normalize the roots once per extraction.
+  if (!sourceRootCache.roots) {
+    std::vector<boost::filesystem::path> r;
+    for (const auto& root : sourceRoots) {
+      boost::filesystem::path path = boost::filesystem::weakly_canonical(root);
+      // Drop the trailing "." left by a trailing separator.
+      if (path.filename() == ".") path = path.parent_path();
+      r.push_back(path);
+    }
+    sourceRootCache.roots = std::move(r);
+  }
+  // Many nodes share a file, so cache the result per file ID.
+  std::unordered_map<int, bool>& fileCache = sourceRootCache.files;
+  const int fileId = fi->get_file_id();
+  auto it = fileCache.find(fileId);
+  if (it != fileCache.end()) return it->second;
+
+  const boost::filesystem::path file =
+      boost::filesystem::weakly_canonical(fi->get_filenameString());
+  bool inRoots = false;
+  for (const auto& root : *sourceRootCache.roots) {
+    // The file must contain every component of the root as a prefix.
+    const auto res =
+        std::mismatch(root.begin(), root.end(), file.begin(), file.end());
+    if (res.first == root.end()) {
+      inRoots = true;
+      break;
+    }
+  }
+  LOG(DEBUG) << fi->get_filenameString() << " is "
+             << (inRoots ? "" : "not ") << "within the source roots."
+             << std::endl;
+  fileCache.emplace(fileId, inRoots);
+  return inRoots;
+}
+
 // NOTE: We use a recursive call for the sake of the type system. Intermediate
 // results may not be the right node type, but the final one always should be.
 // TODO: Peter: Check to see if some of these special cases should be handled by
 // SageInterface::Ada::logicalParentScope().
 template <typename T>
 static SgNode* GetScopeRecurse(SgNode* n, SgNode* orig) {
+  scopeRecurseSteps.Add();
   if (n == nullptr) {
     LOG(TRACE) << "n was null. No scope found." << std::endl;
     return nullptr;
@@ -419,6 +508,16 @@ bool IsClassOwner(SgExpression* id, const MType& mId) {
   return false;
 }
 
+// ROSE's node variants, for VariantTable.
+struct RoseVariants {
+  using Variant = VariantT;
+  static constexpr std::size_t count = V_SgNumVariants;
+  VariantVector Derived(const VariantT v) const { return VariantVector(v); }
+};
+
+template <typename H>
+using VariantTable = BasicVariantTable<H, RoseVariants>;
+
 // Class, Method, and Attribute objects are all Component types.
 // They are distinguished by the use of node pointers as unique IDs.
 template <typename T>
@@ -670,6 +769,10 @@ class IA {
   // These can be used for lookup.
   // All other locations in the code should use references to these objects,
   // rather than making copies.
+  // TODO: These maps, and the settings in define.hpp the handlers read, are
+  // process-wide, so only one extraction can run at a time and the unit tests
+  // are only reset between cases, not isolated. Moving them into a context
+  // passed through GetClassData would allow extractions side by side.
   static std::map<C, Class<C>> classData;
   static std::map<MType, Method<C>> methodData;
   static std::map<AType, Attribute<C>> attributeData;
@@ -679,9 +782,13 @@ class IA {
   static std::map<MType, MType> methodAliasMap;
   static std::map<SgNode*, MType> cStyleMethodAliasMap;
 
+  // Set when the current subtree lies outside of the sourceRoots. Everything
+  // beneath it is skipped.
+  bool pruned = false;
+
   // Specific constructors are required to create a valid inherited attribute.
   IA(){};
-  IA(const IA& X){};
+  IA(const IA& X) : pruned(X.pruned){};
   // IA(const IA& X) : class_(X.class_), Method_(X.method_){};
 
   // Print out all currently processed class, method, and attribute data.
@@ -704,6 +811,44 @@ class IA {
     }
     return os;
   }
+  // Drop all processed data. The maps reference AST nodes, so this must be
+  // done before the AST is released or when starting a fresh extraction.
+  static void Clear() {
+    classData.clear();
+    methodData.clear();
+    attributeData.clear();
+    attributeAliasMap.clear();
+    methodAliasMap.clear();
+    cStyleMethodAliasMap.clear();
+    ClearSourceRoots();
+  }
+  // Record the element counts and approximate sizes of the maps in the
+  // profile.
+  static void RecordMemory(const std::string& classType) {
+    if (!Profile::Enabled()) return;
+    std::size_t classBytes = Profile::NodeBytes(classData);
+    for (const auto& c : classData) {
+      classBytes += Profile::NodeBytes(std::get<1>(c).methods);
+    }
+    std::size_t methodBytes = Profile::NodeBytes(methodData);
+    for (const auto& m : methodData) {
+      methodBytes += Profile::NodeBytes(std::get<1>(m).attributes) +
+                     Profile::NodeBytes(std::get<1>(m).calledMethods);
+    }
+    Profile::AddMemory(classType + ":classData", classData.size(), classBytes);
+    Profile::AddMemory(classType + ":methodData", methodData.size(),
+                       methodBytes);
+    Profile::AddMemory(classType + ":attributeData", attributeData.size(),
+                       Profile::NodeBytes(attributeData));
+    Profile::AddMemory(classType + ":attributeAliasMap",
+                       attributeAliasMap.size(),
+                       Profile::NodeBytes(attributeAliasMap));
+    Profile::AddMemory(classType + ":methodAliasMap", methodAliasMap.size(),
+                       Profile::NodeBytes(methodAliasMap));
+    Profile::AddMemory(classType + ":cStyleMethodAliasMap",
+                       cStyleMethodAliasMap.size(),
+                       Profile::NodeBytes(cStyleMethodAliasMap));
+  }
   static std::string printClassData() {
     std::stringstream ss;
     ss << "Contents of classData:" << std::endl;
@@ -756,6 +901,7 @@ std::map<SgNode*, MType> IA<C>::cStyleMethodAliasMap;
 // NOTE: The vector stores the full resolution of record-field
 // relationships.
 std::vector<SgExpression*> GetRootExp(SgExpression* exp) {
+  Stats::Depth::Guard depthGuard(rootExpDepth);
   if (!exp) LOG(WARNING) << " nullptr passed into GetRootExp()." << std::endl;
 
   // Traverse down each attribute renaming.
@@ -959,6 +1105,30 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
     return decl;
   }
 
+  // The handlers used by evaluateInheritedAttribute().
+  enum class Handler {
+    None,
+    Method,
+    AdaRenamingRefExp,
+    VarRefExp,
+    FunctionRefExp,
+    MemberFunctionRefExp,
+    Expression,
+    CtorInitializerList
+  };
+  static const VariantTable<Handler>& Dispatch() {
+    static const VariantTable<Handler> table(
+        Handler::None,
+        {{V_SgFunctionDeclaration, Handler::Method},
+         {V_SgAdaRenamingRefExp, Handler::AdaRenamingRefExp},
+         {V_SgVarRefExp, Handler::VarRefExp},
+         {V_SgFunctionRefExp, Handler::FunctionRefExp},
+         {V_SgMemberFunctionRefExp, Handler::MemberFunctionRefExp},
+         {V_SgExpression, Handler::Expression},
+         {V_SgCtorInitializerList, Handler::CtorInitializerList}});
+    return table;
+  }
+
   static IA<C> HandleMethod(const MType& pId, IA<C>& ia) {
     if (!pId)
       LOG(FATAL) << "Null method passed into HandleMethod()." << std::endl;
@@ -1077,6 +1247,14 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
     // PP 05/13/24 added null test
     if (baseRootExp == nullptr) return IA<C>(ia);
 
+    // Ignore references to variables declared outside the analyzed sources.
+    if (!IsInSourceRoots(baseRootExp->get_symbol()->get_declaration())) {
+      LOG(DEBUG) << NPrint::p(baseRootExp)
+                 << " is declared outside the source roots. Ignoring."
+                 << std::endl;
+      return IA<C>(ia);
+    }
+
     Method<C>* mPtr = GetOwningMethod<C>(baseRootExp);
     if (!mPtr) return IA<C>(ia);
     Method<C>& owningMethod = *mPtr;
@@ -1139,6 +1317,9 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
     // Check if the attribute exists in the attributeAliasMap
     // If it is found, check for further aliases.
     auto it = IA<C>::attributeAliasMap.find(aDecl.GetId());
+    (it != IA<C>::attributeAliasMap.end() ? attributeAliasHits
+                                          : attributeAliasMisses)
+        .Add();
     if (it != IA<C>::attributeAliasMap.end()){
       LOG(DEBUG) << "Attribute " << aDecl << " is in attributeAliasMap, swapping with "
                  << it->second << std::endl;
@@ -1147,6 +1328,9 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
 
     // Check if this attribute is actually an aliased method.
     auto methodIt = IA<C>::cStyleMethodAliasMap.find(aDecl.GetId());
+    (methodIt != IA<C>::cStyleMethodAliasMap.end() ? methodAliasHits
+                                                   : methodAliasMisses)
+        .Add();
     if (methodIt != IA<C>::cStyleMethodAliasMap.end()){
       LOG(DEBUG) << "Attribute " << aDecl << " is in cStyleMethodAliasMap, inserting called method "
                  << methodIt->second << std::endl;
@@ -1194,6 +1378,14 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
     // PP 05/13/24 added null test
     if (baseRootExp == nullptr) return IA<C>(ia);
 
+    // Ignore calls to functions declared outside the analyzed sources.
+    if (!IsInSourceRoots(baseRootExp->get_symbol()->get_declaration())) {
+      LOG(DEBUG) << NPrint::p(baseRootExp)
+                 << " is declared outside the source roots. Ignoring."
+                 << std::endl;
+      return IA<C>(ia);
+    }
+
     Class<C>* cPtr = GetOwningClass<C>(baseRootExp);
     if (!cPtr) return IA<C>(ia);
     Class<C>& owningClass = *cPtr;
@@ -1233,6 +1425,15 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
     std::vector<SgExpression*> root = GetRootExp(id);
     SgMemberFunctionRefExp* baseRootExp = is<SgMemberFunctionRefExp>(GetBaseRootExp(root));
 
+    // Ignore calls to member functions declared outside the analyzed sources.
+    if (baseRootExp &&
+        !IsInSourceRoots(baseRootExp->get_symbol()->get_declaration())) {
+      LOG(DEBUG) << NPrint::p(baseRootExp)
+                 << " is declared outside the source roots. Ignoring."
+                 << std::endl;
+      return IA<C>(ia);
+    }
+
     Class<C>* cPtr = GetOwningClass<C>(baseRootExp);
     if (!cPtr) return IA<C>(ia);
     Class<C>& owningClass = *cPtr;
@@ -1261,13 +1462,24 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
   // It will log unexpected expression types, but most of these are meant to be
   // ignored by the analysis anyway.
   static IA<C> HandleExpression(SgExpression*& id, IA<C> ia) {
-    if (is<SgBinaryOp>(id) || is<SgValueExp>(id) || is<SgInitializer>(id) ||
-        is<SgExprListExp>(id) || is<SgAdaOthersExp>(id) || is<SgRangeExp>(id) ||
-        is<SgCallExpression>(id) || is<SgUnaryOp>(id) ||
-        is<SgNullExpression>(id) || is<SgTypeExpression>(id) ||
-        is<SgAdaUnitRefExp>(id) || is<SgActualArgumentExpression>(id) ||
-        is<SgAdaAttributeExp>(id) || is<SgNewExp>(id) ||
-        is<SgAdaTaskRefExp>(id) || is<SgConditionalExp>(id)) {
+    static const VariantTable<bool> suppressed(
+        false, {{V_SgBinaryOp, true},
+                {V_SgValueExp, true},
+                {V_SgInitializer, true},
+                {V_SgExprListExp, true},
+                {V_SgAdaOthersExp, true},
+                {V_SgRangeExp, true},
+                {V_SgCallExpression, true},
+                {V_SgUnaryOp, true},
+                {V_SgNullExpression, true},
+                {V_SgTypeExpression, true},
+                {V_SgAdaUnitRefExp, true},
+                {V_SgActualArgumentExpression, true},
+                {V_SgAdaAttributeExp, true},
+                {V_SgNewExp, true},
+                {V_SgAdaTaskRefExp, true},
+                {V_SgConditionalExp, true}});
+    if (suppressed[id]) {
       // Suppressed.
       LOG(DEBUG) << "Suppressing irrelevant expression " << NPrint::p(id)
                  << " of type " << id->class_name() << std::endl;
@@ -1400,28 +1612,59 @@ class VisitorTraversal : public AstTopDownProcessing<IA<C>> {
 
  public:
   IA<C> evaluateInheritedAttribute(SgNode* n, IA<C> ia) {
-    if (MType m = is<MType>(n)) {
-      LOG(INFO) << "Handling MType " << NPrint::p(m) << std::endl;
-      return HandleMethod(m, ia);
-    } else if (SgAdaRenamingRefExp* arre = is<SgAdaRenamingRefExp>(n)) {
-      LOG(INFO) << "Handling SgAdaRenamingRefExp " << NPrint::p(arre)
-                << std::endl;
-      return HandleAdaRenamingRefExp(arre, ia);
-    } else if (SgVarRefExp* vre = is<SgVarRefExp>(n)) {
-      LOG(INFO) << "Handling SgVarRefExp " << NPrint::p(vre) << std::endl;
-      return HandleSgVarRefExp(vre, ia);
-    } else if (SgFunctionRefExp* fre = is<SgFunctionRefExp>(n)) {
-      LOG(INFO) << "Handling SgFunctionRefExp " << NPrint::p(vre) << std::endl;
-      return HandleSgFunctionRefExp(fre, ia);
-    } else if (SgMemberFunctionRefExp *mfre = is<SgMemberFunctionRefExp>(n)) {
-      LOG(INFO) << "Handling SgMemberFunctionRefExp " << NPrint::p(mfre) << std::endl;
-      return HandleSgMemberFunctionRefExp(mfre, ia);
-    } else if (SgExpression* e = is<SgExpression>(n)) {
-      LOG(INFO) << "Handling SgExpression " << NPrint::p(e) << std::endl;
-      return HandleExpression(e, ia);
-    } else if (SgCtorInitializerList* cil = is<SgCtorInitializerList>(n)) {
-      LOG(INFO) << "Handling SgCtorInitializerList " << NPrint::p(cil) << std::endl;
-      return HandleSgCtorInitializerList(cil, ia);
+    visitorVisits.Add(n->variantT());
+    // Skip subtrees outside the analyzed sources.
+    if (ia.pruned) return IA<C>(ia);
+    if (!IsInSourceRoots(n)) {
+      LOG(DEBUG) << "Pruning " << NPrint::p(n)
+                 << " because it is outside the source roots." << std::endl;
+      IA<C> pruned(ia);
+      pruned.pruned = true;
+      return pruned;
+    }
+
+    switch (Dispatch()[n]) {
+      case Handler::Method: {
+        MType m = static_cast<MType>(n);
+        LOG(INFO) << "Handling MType " << NPrint::p(m) << std::endl;
+        return HandleMethod(m, ia);
+      }
+      case Handler::AdaRenamingRefExp: {
+        SgAdaRenamingRefExp* arre = static_cast<SgAdaRenamingRefExp*>(n);
+        LOG(INFO) << "Handling SgAdaRenamingRefExp " << NPrint::p(arre)
+                  << std::endl;
+        return HandleAdaRenamingRefExp(arre, ia);
+      }
+      case Handler::VarRefExp: {
+        SgVarRefExp* vre = static_cast<SgVarRefExp*>(n);
+        LOG(INFO) << "Handling SgVarRefExp " << NPrint::p(vre) << std::endl;
+        return HandleSgVarRefExp(vre, ia);
+      }
+      case Handler::FunctionRefExp: {
+        SgFunctionRefExp* fre = static_cast<SgFunctionRefExp*>(n);
+        LOG(INFO) << "Handling SgFunctionRefExp " << NPrint::p(fre)
+                  << std::endl;
+        return HandleSgFunctionRefExp(fre, ia);
+      }
+      case Handler::MemberFunctionRefExp: {
+        SgMemberFunctionRefExp* mfre = static_cast<SgMemberFunctionRefExp*>(n);
+        LOG(INFO) << "Handling SgMemberFunctionRefExp " << NPrint::p(mfre)
+                  << std::endl;
+        return HandleSgMemberFunctionRefExp(mfre, ia);
+      }
+      case Handler::Expression: {
+        SgExpression* e = static_cast<SgExpression*>(n);
+        LOG(INFO) << "Handling SgExpression " << NPrint::p(e) << std::endl;
+        return HandleExpression(e, ia);
+      }
+      case Handler::CtorInitializerList: {
+        SgCtorInitializerList* cil = static_cast<SgCtorInitializerList*>(n);
+        LOG(INFO) << "Handling SgCtorInitializerList " << NPrint::p(cil)
+                  << std::endl;
+        return HandleSgCtorInitializerList(cil, ia);
+      }
+      case Handler::None:
+        break;
     }
     return IA<C>(ia);
   }
@@ -1465,6 +1708,19 @@ class RenamingTraversal : public AstTopDownProcessing<IA<C>> {
     return nullptr;
   }
 
+  // The handlers used by evaluateInheritedAttribute().
+  enum class Handler { None, SourceFile, Class, AdaRenamingDecl, InitializedName };
+  static const VariantTable<Handler>& Dispatch() {
+    static const VariantTable<Handler> table(
+        Handler::None,
+        {{V_SgSourceFile, Handler::SourceFile},
+         {static_cast<VariantT>(std::remove_pointer_t<C>::static_variant),
+          Handler::Class},
+         {V_SgAdaRenamingDecl, Handler::AdaRenamingDecl},
+         {V_SgInitializedName, Handler::InitializedName}});
+    return table;
+  }
+
   static IA<C> HandleVariableReference(SgInitializedName*& initId, SgVarRefExp *refToVar, IA<C>& ia) {
     // Convert the expression to a proper AType.
     AType a = AType(std::vector<SgExpression*>{refToVar});
@@ -1523,15 +1779,10 @@ class RenamingTraversal : public AstTopDownProcessing<IA<C>> {
   static IA<C> HandleSourceFile(SgSourceFile*& id, IA<C>& ia) {
     sourceFile = id->get_sourceFileNameWithPath();
     // Hash the path to anonymize it.
-    if (anonymous) {
-      boost::filesystem::path anonymizedPath;
-      for (const auto& part : sourceFile) {
-        std::hash<std::string> hasher;
-        anonymizedPath /= std::to_string(hasher(part.string()));
-      }
-      sourceFile = anonymizedPath;
-    }
+    if (anonymous) sourceFile = Anonymize::Path(sourceFile);
     LOG(INFO) << "Found a source file at " << sourceFile << std::endl;
+    // Runs are told apart by their file in the profile.
+    Profile::SetInfo("file", sourceFile.string());
     return IA<C>(ia);
   }
   static IA<C> HandleClass(C& c, IA<C>& ia) {
@@ -1651,21 +1902,45 @@ class RenamingTraversal : public AstTopDownProcessing<IA<C>> {
   // This method is called for each node visited during the AST traversal. 
   // The return value (IA) computed here is the input value to this function at all child nodes
   IA<C> evaluateInheritedAttribute(SgNode* n, IA<C> ia) {
-    if (SgSourceFile* sf = is<SgSourceFile>(n)) {
-      LOG(INFO) << "Handling SgSourceFile " << NPrint::p(sf) << std::endl;
-      return HandleSourceFile(sf, ia);
-    } else if (C c = is<C>(n)) {
-      if (SgNamespaceDeclarationStatement* ns = is<SgNamespaceDeclarationStatement*>(n)) {
-        c = is<C>(ns->get_firstNondefiningDeclaration());
+    renamingVisits.Add(n->variantT());
+    // Skip subtrees outside the analyzed sources.
+    if (ia.pruned) return IA<C>(ia);
+    if (!IsInSourceRoots(n)) {
+      LOG(DEBUG) << "Pruning " << NPrint::p(n)
+                 << " because it is outside the source roots." << std::endl;
+      IA<C> pruned(ia);
+      pruned.pruned = true;
+      return pruned;
+    }
+
+    switch (Dispatch()[n]) {
+      case Handler::SourceFile: {
+        SgSourceFile* sf = static_cast<SgSourceFile*>(n);
+        LOG(INFO) << "Handling SgSourceFile " << NPrint::p(sf) << std::endl;
+        return HandleSourceFile(sf, ia);
+      }
+      case Handler::Class: {
+        C c = static_cast<C>(n);
+        if (SgNamespaceDeclarationStatement* ns = is<SgNamespaceDeclarationStatement*>(n)) {
+          c = is<C>(ns->get_firstNondefiningDeclaration());
+        }
+        LOG(INFO) << "Handling C " << NPrint::p(c) << std::endl;
+        return HandleClass(c, ia);
+      }
+      case Handler::AdaRenamingDecl: {
+        SgAdaRenamingDecl* ard = static_cast<SgAdaRenamingDecl*>(n);
+        LOG(INFO) << "Handling SgAdaRenamingDecl " << NPrint::p(ard)
+                  << std::endl;
+        return HandleSgAdaRenamingDecl(ard, ia);
       }
-      LOG(INFO) << "Handling C " << NPrint::p(c) << std::endl;
-      return HandleClass(c, ia);
-    } else if (SgAdaRenamingDecl* ard = is<SgAdaRenamingDecl>(n)) {
-      LOG(INFO) << "Handling SgAdaRenamingDecl " << NPrint::p(ard) << std::endl;
-      return HandleSgAdaRenamingDecl(ard, ia);
-    } else if (SgInitializedName* in = is<SgInitializedName>(n)) {
-      LOG(INFO) << "Handling SgInitializedName " << NPrint::p(in) << std::endl;
-      return HandleSgInitializedName(in, ia);
+      case Handler::InitializedName: {
+        SgInitializedName* in = static_cast<SgInitializedName*>(n);
+        LOG(INFO) << "Handling SgInitializedName " << NPrint::p(in)
+                  << std::endl;
+        return HandleSgInitializedName(in, ia);
+      }
+      case Handler::None:
+        break;
     }
     return IA<C>(ia);
   }
@@ -1674,28 +1949,187 @@ class RenamingTraversal : public AstTopDownProcessing<IA<C>> {
 SgProject* GetProject(std::vector<std::string> cmdLineArgs) {
   // Initialize and check compatibility.
   ROSE_INITIALIZE;
-  SgProject* project = frontend(cmdLineArgs);
-  if (!project)
-    LOG(FATAL) << "Frontend did not return a valid SgProject." << std::endl;
+  Trace::Span span("GetProject");
+  SgProject* project = nullptr;
+  if (!astInput.empty()) {
+    // Parsing large systems takes far longer than analyzing them. Reuse an AST
+    // saved by a previous run instead of running the frontend again.
+    if (cmdLineArgs.size() > 1)
+      LOG(NOTICE) << "Loading the AST from " << astInput
+                  << ". Frontend arguments will be ignored." << std::endl;
+    Profile::Scope scope("LoadAST");
+    project = AST_FILE_IO::readASTFromFile(astInput);
+    if (!project)
+      LOG(FATAL) << "Failed to load a valid SgProject from " << astInput
+                 << std::endl;
+  } else {
+    Profile::Scope scope("Frontend");
+    project = frontend(cmdLineArgs);
+    if (!project)
+      LOG(FATAL) << "Frontend did not return a valid SgProject." << std::endl;
+  }
   ROSE_ASSERT(project != NULL);
+  Profile::AddCount("astNodes", numberOfNodes());
+
+  if (!astOutput.empty()) {
+    LOG(INFO) << "Saving the AST to " << astOutput << std::endl;
+    Profile::Scope scope("WriteAST");
+    AST_FILE_IO::startUp(project);
+    AST_FILE_IO::writeASTToFile(astOutput);
+    // Writing leaves the memory pools in a serialization state. Restore them
+    // so the AST can still be traversed.
+    AST_FILE_IO::resetValidAstAfterWriting();
+  }
   return project;
 }
 
+// Delete the AST along with ROSE's memory pools.
+// Anything that needs node contents (names, source locations, etc.) must be
+// extracted beforehand. Node IDs remain usable as keys, but are dangling.
+void ReleaseProject(SgProject*& project) {
+  LOG(INFO) << "Releasing the AST." << std::endl;
+  Profile::Scope scope("ReleaseAST");
+  AST_FILE_IO::clearAllMemoryPools();
+  NPrint::Clear();
+  ClearSourceRoots();
+  project = nullptr;
+  astReleased = true;
+}
+
+// Finds the input file in which traverseInputFiles() visits a node.
+// The memory pools also hold nodes the tree walk never reaches, such as the
+// expressions inside types (e.g., array dimensions), so a node only matches if
+// every link of its parent chain up to an input file is a traversal successor.
+// Each link must also pass the checks the tree walk prunes subtrees with: the
+// file constraint of traverseInputFiles() and the source roots.
+// Results are cached per node, as the nodes of a pool share most ancestors.
+class InputFileFinder {
+  const std::set<SgFile*> inputFiles;
+  std::unordered_map<SgNode*, SgSourceFile*> files;
+  // Parents whose traversal successors have been added to linked.
+  std::unordered_set<SgNode*> expanded;
+  // Nodes that are traversal successors of their own parent.
+  std::unordered_set<SgNode*> linked;
+
+  // Whether n is a traversal successor of its parent. The successors of each
+  // parent are only listed once, as parents such as global scopes can have
+  // many children.
+  bool IsSuccessor(SgNode* n, SgNode* parent) {
+    if (expanded.insert(parent).second) {
+      for (SgNode* s : parent->get_traversalSuccessorContainer()) {
+        if (s && s->get_parent() == parent) linked.insert(s);
+      }
+    }
+    return linked.count(n) != 0;
+  }
+
+  // Whether the file constraint of traverseInputFiles() accepts a node.
+  // Nodes from included files are rejected unless they are
+  // compiler-generated.
+  static bool InFile(SgNode* n, SgSourceFile* file) {
+    SgLocatedNode* ln = is<SgLocatedNode>(n);
+    if (!ln) return true;
+    Sg_File_Info* fi = ln->get_file_info();
+    return !fi || fi->isCompilerGenerated() || fi->isSameFile(file);
+  }
+
+ public:
+  explicit InputFileFinder(SgProject* project)
+      : inputFiles(project->get_fileList().begin(),
+                   project->get_fileList().end()) {}
+
+  // The input file the node is visited in, or null if it is never visited.
+  SgSourceFile* Find(SgNode* n) {
+    auto it = files.find(n);
+    if (it != files.end()) return it->second;
+
+    SgSourceFile* file = nullptr;
+    if (SgSourceFile* sf = is<SgSourceFile>(n)) {
+      if (inputFiles.count(sf)) file = sf;
+    } else if (SgNode* parent = n->get_parent()) {
+      if (IsSuccessor(n, parent)) file = Find(parent);
+      if (file && (!InFile(n, file) || !IsInSourceRoots(n))) file = nullptr;
+    }
+    files.emplace(n, file);
+    return file;
+  }
+};
+
+// Feed every node in the memory pools of the given variants (and the variants
+// derived from them) to a traversal, as if it was visited by the tree walk.
+// Variant groups are processed in order, so nodes a later group depends on
+// (e.g., methods before the references inside them) must come first.
+// NOTE: The handlers share the static IA maps, so the scan is sequential.
+template <typename C, typename Traversal>
+void ScanMemoryPools(InputFileFinder& finder, Traversal& traversal,
+                     const std::vector<VariantT>& variants) {
+  for (const VariantT& variant : variants) {
+    VariantVector variantVector(variant);
+    const std::vector<SgNode*> nodes =
+        NodeQuery::queryMemoryPool(variantVector);
+    LOG(INFO) << "Scanning " << nodes.size() << " nodes of type "
+              << getVariantName(variant) << "." << std::endl;
+
+    SgSourceFile* currentFile = nullptr;
+    for (SgNode* n : nodes) {
+      SgSourceFile* file = finder.Find(n);
+      if (!file) continue;
+      // Let the traversal see the source file first, as the tree walk would.
+      if (file != currentFile) {
+        traversal.evaluateInheritedAttribute(file, IA<C>());
+        currentFile = file;
+      }
+      traversal.evaluateInheritedAttribute(n, IA<C>());
+    }
+  }
+}
+
 template <typename C>
 const std::vector<LCOM::Class<C, MType, AType>> GetClassData(
     SgProject*& project) {
   // The inherited attribute.
   IA<C> ia = IA<C>();
-
-  // Start by finding attribute renamings in a first pass.
-  LOG(INFO) << "Starting renaming traversal." << std::endl;
   RenamingTraversal<C> rTraversal;
-  rTraversal.traverseInputFiles(project, ia);
-
-  // Now perform the main traversal.
-  LOG(INFO) << "Starting visitor traversal." << std::endl;
   VisitorTraversal<C> vTraversal;
-  vTraversal.traverseInputFiles(project, ia);
+
+  const std::string classType = typeid(C).name();
+
+  if (extraction == Extraction::MemoryPool) {
+    // Only a few node types matter, so scan just their memory pools.
+    InputFileFinder finder(project);
+    LOG(INFO) << "Starting renaming memory pool scan." << std::endl;
+    {
+      Profile::Scope scope("RenamingTraversal", classType);
+      ScanMemoryPools<C>(
+          finder, rTraversal,
+          {static_cast<VariantT>(std::remove_pointer_t<C>::static_variant),
+           V_SgAdaRenamingDecl, V_SgInitializedName});
+    }
+    LOG(INFO) << "Starting visitor memory pool scan." << std::endl;
+    {
+      Profile::Scope scope("VisitorTraversal", classType);
+      ScanMemoryPools<C>(
+          finder, vTraversal,
+          {V_SgFunctionDeclaration, V_SgAdaRenamingRefExp, V_SgVarRefExp,
+           V_SgFunctionRefExp, V_SgMemberFunctionRefExp,
+           V_SgCtorInitializerList});
+    }
+  } else {
+    // Start by finding attribute renamings in a first pass.
+    LOG(INFO) << "Starting renaming traversal." << std::endl;
+    {
+      Profile::Scope scope("RenamingTraversal", classType);
+      rTraversal.traverseInputFiles(project, ia);
+    }
+
+    // Now perform the main traversal.
+    LOG(INFO) << "Starting visitor traversal." << std::endl;
+    {
+      Profile::Scope scope("VisitorTraversal", classType);
+      vTraversal.traverseInputFiles(project, ia);
+    }
+  }
+  IA<C>::RecordMemory(classType);
 
   // Convert node data into a format accepted by LCOM.
   std::vector<LCOM::Class<C, MType, AType>> dataLCOM;
@@ -1703,9 +2137,17 @@ const std::vector<LCOM::Class<C, MType, AType>> GetClassData(
   auto& classData = IA<C>::classData;
   for (auto i = classData.begin(); i != classData.end();) {
     auto& classInst = std::get<1>(*i);
+    // Only resolve the name when it will be used.
+    const std::string className =
+        Profile::Enabled() || Trace::Enabled()
+            ? NPrint::simple_name(classInst.GetId())
+            : "";
 
     // Filter out class data we don't want.
-    classInst.Filter();
+    {
+      Profile::Scope scope("Filter", classType, className);
+      classInst.Filter();
+    }
 
     if (classInst.methods.size() == 0) {
       LOG(INFO) << "Skipping empty class " << classInst << std::endl;
@@ -1716,10 +2158,21 @@ const std::vector<LCOM::Class<C, MType, AType>> GetClassData(
     }
     LOG(INFO) << "Converting " << classInst << " to LCOM format." << std::endl;
     LOG(TRACE) << classInst << std::endl;
-    dataLCOM.push_back(classInst.ToLCOMClass());
+    {
+      Profile::Scope scope("ToLCOMClass", classType, className);
+      dataLCOM.push_back(classInst.ToLCOMClass());
+    }
     LOG(DEBUG) << dataLCOM.back() << " added to LCOM data." << std::endl;
   }
   LOG(DEBUG) << "Found " << classData.size() << " classes." << std::endl;
+  Profile::AddCount(classType + ":classes", dataLCOM.size());
+  if (Profile::Enabled()) {
+    std::size_t bytes = dataLCOM.capacity() * sizeof(dataLCOM.front());
+    for (const auto& classInst : dataLCOM) {
+      bytes += LCOM::ApproxBytes(classInst) - sizeof(classInst);
+    }
+    Profile::AddMemory(classType + ":LCOMClasses", dataLCOM.size(), bytes);
+  }
 
   // Print out the final class data.
   // We can use this to evaluate if the graph matches what we expect.
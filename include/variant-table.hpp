@@ -0,0 +1,50 @@
+#ifndef VARIANT_TABLE_HPP
+#define VARIANT_TABLE_HPP
+
+// Handler dispatch by node variant, used by the traversals in traverse.hpp.
+// This header does not depend on ROSE. The variants and their hierarchy are
+// supplied by a Variants type, so lcom-bench can measure the same table on a
+// synthetic hierarchy.
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Traverse {
+
+// Maps every node variant to a handler, so dispatching a node costs a single
+// indexed lookup on variantT() instead of a cascade of is<T> checks.
+// The table is built from the variant hierarchy, so each listed type also
+// covers all of its derived types. Entries are given in priority order: a
+// variant derived from several listed types uses the first matching entry,
+// just like the is<T> cascade it replaces.
+// Variants must provide:
+//   Variant     the type of a variant, convertible to an index
+//   count       the number of variants
+//   Derived(v)  a range of v and every variant derived from it
+template <typename H, typename Variants>
+class BasicVariantTable {
+  std::vector<H> table;
+
+ public:
+  BasicVariantTable(
+      H none,
+      const std::vector<std::pair<typename Variants::Variant, H>>& entries,
+      const Variants& variants = Variants())
+      : table(Variants::count, none) {
+    // Assign from lowest to highest priority so earlier entries win.
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      for (const auto& v : variants.Derived(it->first)) {
+        table[v] = it->second;
+      }
+    }
+  }
+  template <typename N>
+  H operator[](const N* n) const {
+    return table[n->variantT()];
+  }
+};
+
+}  // namespace Traverse
+
+#endif  // VARIANT_TABLE_HPP
@@ -1,5 +1,6 @@
 import argparse
 import concurrent.futures
+import csv
 import fnmatch
 import os
 import shutil
@@ -230,12 +231,39 @@ def make_dot_graphs():
         task.wait()
 
 
+def sort_csv_rows(path):
+    """Sort the rows of a CSV file by file, then class, keeping the header first.
+
+    Runs append their rows to a shared file in the order they finish, which
+    changes from one invocation to the next. Rows are compared by their parsed
+    fields and written back unchanged.
+    """
+    if not os.path.exists(path):
+        return
+    with open(path, newline="") as f:
+        lines = f.read().splitlines(keepends=True)
+    if len(lines) < 2:
+        return
+    header, rows = lines[0], lines[1:]
+    rows.sort(key=lambda line: next(csv.reader([line])))
+    with open(path + ".tmp", "w", newline="") as f:
+        f.write(header)
+        f.writelines(rows)
+    os.replace(path + ".tmp", path)
+
+
 def gen_lcom():
     EXEC = os.path.join(Config.BUILD_DIR, "lcom.out")
     wait("build")
     wait("wipe_output", optional=True)
     print("Computing LCOM")
 
+    # When the LCOM DOT graphs are requested too, lcom.out writes them from the
+    # same extraction, so every file is only parsed once.
+    outputs = ["csv"]
+    if "make_lcom_dot_graphs" in tasks_to_execute:
+        outputs.append("dot")
+
     def lcom(file):
         print(
             "Generating LCOM metrics for "
@@ -254,44 +282,39 @@ def gen_lcom():
                     Config.DOT_BEHAVIOR,
                     "--lcom:class-type",
                     Config.CLASS_TYPE,
-                    "--lcom:csv-output",
-                    SAVE_PATH + ".csv",
+                    "--lcom:shared-output",
+                    LCOM_CSV,
+                    "--lcom:outputs",
+                    ",".join(outputs),
+                    "--lcom:dot-output",
+                    os.path.dirname(SAVE_PATH),
                 ]
                 + Config.ARGS.split(),
                 f,
                 os.path.join(os.path.dirname(SAVE_PATH), "workingDir-lcom"),
             )
 
+    # Every lcom.out process appends its rows to the same file, and the first
+    # one writes the header.
+    LCOM_CSV = os.path.join(Config.OUT_DIR, "lcom.csv")
+    os.makedirs(Config.OUT_DIR, exist_ok=True)
+    if os.path.exists(LCOM_CSV):
+        os.remove(LCOM_CSV)
     src_files = list_files(Config.DIR, ["adb", "cpp"], use_exclusions=True)
     wait_list = []
     for file in src_files:
         wait_list.append(lcom(file))
     for task in wait_list:
         task.wait()
-
-
-def combine_csv():
-    wait("gen_lcom", optional=True)
-    print("Combining LCOM metrics into a CSV")
-    csv_output = b""
-    # Read in the header.
-    with open(os.path.join(Config.PROJECT, "header.csv"), "rb") as header:
-        csv_output += header.read()
-    # Read in the remaining files.
-    csv_files = list_files(Config.OUT_DIR, ["csv"], use_exclusions=False)
-    for file in csv_files:
-        with open(file, "rb") as file_contents:
-            csv_output += file_contents.read()
-    # Write the output to file.
-    wait("wipe_output", optional=True)
-    os.makedirs(Config.OUT_DIR, exist_ok=True)
-    with open(os.path.join(Config.OUT_DIR, "lcom.csv"), "wb") as lcom_file:
-        lcom_file.write(csv_output)
-    return
+    sort_csv_rows(LCOM_CSV)
 
 
 def make_lcom_dot_graphs():
     EXEC = os.path.join(Config.BUILD_DIR, "lcom-dot.out")
+    # gen_lcom writes the graphs along with the metrics when both run.
+    if "gen_lcom" in tasks_to_execute:
+        wait("gen_lcom")
+        return
     wait("build")
     wait("wipe_output", optional=True)
     print("Generating LCOM DOT graphs")
@@ -392,7 +415,6 @@ def main():
         make_dot_graphs,
         gen_lcom,
         make_lcom_dot_graphs,
-        combine_csv,
         run_gtests,
     ]
     for func in functions:
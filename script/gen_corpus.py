@@ -0,0 +1,207 @@
+"""Generate a synthetic source corpus for scaling benchmarks.
+
+Writes Ada packages and C++ classes with a chosen number of methods,
+attributes, record nesting depth, renamings and cross-calls. Every parameter
+accepts a comma-separated list, and one source is generated for every
+combination, so the cost of each dimension can be measured in isolation.
+
+Example:
+    python3 script/gen_corpus.py --out output/corpus --methods 10,100,1000
+"""
+
+import argparse
+import itertools
+import json
+import os
+import random
+
+
+class Params:
+    """The shape of a single generated class."""
+
+    def __init__(self, methods, attributes, depth, renamings, calls, accesses):
+        # The number of methods.
+        self.methods = methods
+        # The number of attributes.
+        self.attributes = attributes
+        # How deeply records are nested. 0 makes every attribute an integer.
+        self.depth = depth
+        # Renamings (Ada) or references (C++) to attributes per method.
+        self.renamings = renamings
+        # Calls to other methods of the same class per method.
+        self.calls = calls
+        # Attribute accesses per method, not counting renamings.
+        self.accesses = accesses
+
+    def name(self):
+        return (
+            f"gen_m{self.methods}_a{self.attributes}_d{self.depth}"
+            f"_r{self.renamings}_c{self.calls}"
+        )
+
+    def as_dict(self):
+        return dict(vars(self), name=self.name())
+
+
+# Fields per record. Paths through nested records pick one at each level.
+FIELDS = 2
+
+
+def field_path(rng, depth, sep):
+    """A random path from an attribute down to an integer leaf."""
+    return "".join(f"{sep}f{rng.randrange(FIELDS)}" for _ in range(depth))
+
+
+def gen_ada(params, rng):
+    """Return the spec and body of an Ada package."""
+    name = params.name()
+    spec = [f"package {name} is"]
+    # Build the record types from the innermost out.
+    leaf = "Integer"
+    for level in range(params.depth, 0, -1):
+        spec.append(f"   type Rec{level} is record")
+        for f in range(FIELDS):
+            spec.append(f"      f{f} : {leaf};")
+        spec.append("   end record;")
+        leaf = f"Rec{level}"
+    for a in range(params.attributes):
+        spec.append(f"   a{a} : {leaf};")
+    for m in range(params.methods):
+        spec.append(f"   procedure m{m};")
+    spec.append(f"end {name};")
+
+    body = [f"package body {name} is"]
+    for m in range(params.methods):
+        body.append(f"   procedure m{m} is")
+        renamed = []
+        for r in range(params.renamings):
+            attr = f"a{rng.randrange(params.attributes)}"
+            body.append(
+                f"      r{r} : Integer renames {attr}{field_path(rng, params.depth, '.')};"
+            )
+            renamed.append(f"r{r}")
+        body.append("   begin")
+        statements = []
+        for _ in range(params.accesses):
+            lhs = f"a{rng.randrange(params.attributes)}{field_path(rng, params.depth, '.')}"
+            rhs = f"a{rng.randrange(params.attributes)}{field_path(rng, params.depth, '.')}"
+            statements.append(f"      {lhs} := {rhs} + 1;")
+        for r in renamed:
+            statements.append(f"      {r} := {r} + 1;")
+        for _ in range(params.calls):
+            callee = rng.randrange(params.methods)
+            if callee != m:
+                statements.append(f"      m{callee};")
+        body += statements or ["      null;"]
+        body.append(f"   end m{m};")
+    body.append(f"end {name};")
+    return "\n".join(spec) + "\n", "\n".join(body) + "\n"
+
+
+def gen_cpp(params, rng):
+    """Return the source of a C++ class."""
+    name = params.name()
+    src = []
+    leaf = "int"
+    for level in range(params.depth, 0, -1):
+        src.append(f"struct Rec{level} {{")
+        for f in range(FIELDS):
+            src.append(f"  {leaf} f{f};")
+        src.append("};")
+        leaf = f"Rec{level}"
+    src.append(f"class {name} {{")
+    src.append(" public:")
+    for a in range(params.attributes):
+        src.append(f"  {leaf} a{a};")
+    for m in range(params.methods):
+        src.append(f"  void m{m}();")
+    src.append("};")
+    for m in range(params.methods):
+        src.append(f"void {name}::m{m}() {{")
+        renamed = []
+        for r in range(params.renamings):
+            attr = f"a{rng.randrange(params.attributes)}"
+            src.append(f"  int& r{r} = {attr}{field_path(rng, params.depth, '.')};")
+            renamed.append(f"r{r}")
+        for _ in range(params.accesses):
+            lhs = f"a{rng.randrange(params.attributes)}{field_path(rng, params.depth, '.')}"
+            rhs = f"a{rng.randrange(params.attributes)}{field_path(rng, params.depth, '.')}"
+            src.append(f"  {lhs} = {rhs} + 1;")
+        for r in renamed:
+            src.append(f"  {r} += 1;")
+        for _ in range(params.calls):
+            callee = rng.randrange(params.methods)
+            if callee != m:
+                src.append(f"  m{callee}();")
+        src.append("}")
+    return "\n".join(src) + "\n"
+
+
+def int_list(value):
+    return [int(v) for v in value.split(",")]
+
+
+def generate(out_dir, languages, methods, attributes, depths, renamings, calls,
+             accesses=3, seed=0):
+    """Generate the corpus and return one entry per generated source file."""
+    entries = []
+    for m, a, d, r, c in itertools.product(methods, attributes, depths, renamings, calls):
+        # Default to one attribute per two methods.
+        params = Params(m, a if a > 0 else max(1, m // 2), d, r, c, accesses)
+        # Seed per combination so each file is reproducible on its own.
+        seed_str = f"{seed}-{params.name()}"
+        if "ada" in languages:
+            rng = random.Random(seed_str)
+            spec, body = gen_ada(params, rng)
+            path = os.path.join(out_dir, "ada", params.name())
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path + ".ads", "w") as f:
+                f.write(spec)
+            with open(path + ".adb", "w") as f:
+                f.write(body)
+            entries.append(dict(params.as_dict(), language="ada", file=path + ".adb"))
+        if "cpp" in languages:
+            rng = random.Random(seed_str)
+            path = os.path.join(out_dir, "cpp", params.name() + ".cpp")
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "w") as f:
+                f.write(gen_cpp(params, rng))
+            entries.append(dict(params.as_dict(), language="cpp", file=path))
+    with open(os.path.join(out_dir, "corpus.json"), "w") as f:
+        json.dump(entries, f, indent=2)
+    return entries
+
+
+def add_arguments(parser):
+    parser.add_argument("--out", type=str, required=True,
+                        help="Directory to write the corpus to.")
+    parser.add_argument("--languages", type=str, default="ada,cpp",
+                        help='Comma-separated languages to generate. (default: "ada,cpp")')
+    parser.add_argument("--methods", type=int_list, default=[10, 100, 1000],
+                        help='Methods per class. (default: "10,100,1000")')
+    parser.add_argument("--attributes", type=int_list, default=[0],
+                        help='Attributes per class. 0 uses one per two methods. (default: "0")')
+    parser.add_argument("--depth", type=int_list, default=[1],
+                        help='Record nesting depth. (default: "1")')
+    parser.add_argument("--renamings", type=int_list, default=[1],
+                        help='Renamings per method. (default: "1")')
+    parser.add_argument("--calls", type=int_list, default=[1],
+                        help='Calls to other methods per method. (default: "1")')
+    parser.add_argument("--accesses", type=int, default=3,
+                        help="Attribute accesses per method. (default: 3)")
+    parser.add_argument("--seed", type=int, default=0,
+                        help="Random seed. (default: 0)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a synthetic LCOM corpus.")
+    add_arguments(parser)
+    args = parser.parse_args()
+    entries = generate(args.out, args.languages.split(","), args.methods,
+                       args.attributes, args.depth, args.renamings, args.calls,
+                       args.accesses, args.seed)
+    print(f"Generated {len(entries)} files in {args.out}")
+
+
+if __name__ == "__main__":
+    main()
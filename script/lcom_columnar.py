@@ -0,0 +1,168 @@
+"""Read the columnar output of lcom.out (--lcom:format columnar).
+
+See Output::ColumnarSink in include/output.hpp for the layout. Columns are
+loaded with a single copy each, into NumPy arrays when NumPy is available and
+into array.array otherwise.
+
+Convert to CSV, in the format written by --lcom:format csv:
+    python3 script/lcom_columnar.py output/lcom.lcomcol -o output/lcom.csv
+Load in Python:
+    from lcom_columnar import load
+    columns = load("output/lcom.lcomcol")
+    columns["LCOM4"], columns["ClassName"]
+"""
+
+import argparse
+import array
+import math
+import struct
+import sys
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+MAGIC = b"LCOMCOL\0"
+VERSION = 1
+
+# ColumnType in output.hpp: (array typecode, NumPy dtype, size in bytes).
+STRING, UINT64, INT32, FLOAT64 = 1, 2, 3, 4
+TYPES = {
+    STRING: ("I", "<u4", 4),
+    UINT64: ("Q", "<u8", 8),
+    INT32: ("i", "<i4", 4),
+    FLOAT64: ("d", "<f8", 8),
+}
+
+
+def _values(data, column_type):
+    typecode, dtype, _ = TYPES[column_type]
+    if numpy is not None:
+        return numpy.frombuffer(data, dtype=dtype)
+    values = array.array(typecode)
+    values.frombytes(data)
+    if sys.byteorder == "big":
+        values.byteswap()
+    return values
+
+
+def read_groups(path):
+    """Yield each row group as (strings, [(name, type, values), ...])."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[: len(MAGIC)] != MAGIC:
+        raise ValueError(f"{path} is not an LCOM columnar file")
+    (version,) = struct.unpack_from("<I", data, len(MAGIC))
+    if version != VERSION:
+        raise ValueError(f"{path} has unsupported version {version}")
+    view = memoryview(data)
+    offset = len(MAGIC) + 4
+    while offset < len(data):
+        (size,) = struct.unpack_from("<Q", data, offset)
+        offset += 8
+        end = offset + size
+        num_rows, num_strings = struct.unpack_from("<II", data, offset)
+        offset += 8
+        strings = []
+        for _ in range(num_strings):
+            (length,) = struct.unpack_from("<I", data, offset)
+            offset += 4
+            strings.append(bytes(view[offset : offset + length]).decode("utf-8", "surrogateescape"))
+            offset += length
+        (num_columns,) = struct.unpack_from("<I", data, offset)
+        offset += 4
+        columns = []
+        for _ in range(num_columns):
+            column_type, length = struct.unpack_from("<BI", data, offset)
+            offset += 5
+            name = bytes(view[offset : offset + length]).decode()
+            offset += length
+            nbytes = num_rows * TYPES[column_type][2]
+            columns.append((name, column_type, _values(view[offset : offset + nbytes], column_type)))
+            offset += nbytes
+        if offset != end:
+            raise ValueError(f"{path} has a malformed row group")
+        yield strings, columns
+
+
+def load(path):
+    """Return every column of every row group, keyed by name.
+
+    String columns are decoded. Columns missing from some row groups (e.g. the
+    memory columns) are left out.
+    """
+    names = None
+    parts = {}
+    for strings, columns in read_groups(path):
+        group_names = [name for name, _, _ in columns]
+        names = group_names if names is None else [n for n in names if n in group_names]
+        for name, column_type, values in columns:
+            if column_type == STRING:
+                if numpy is not None:
+                    values = numpy.array(strings, dtype=object)[values]
+                else:
+                    values = [strings[i] for i in values]
+            parts.setdefault(name, []).append(values)
+    result = {}
+    for name in names or []:
+        if numpy is not None:
+            result[name] = numpy.concatenate(parts[name])
+        else:
+            result[name] = [v for part in parts[name] for v in part]
+    return result
+
+
+def _quote_path(s):
+    # Matches boost::filesystem::path's operator<<, which escapes with '&'.
+    return '"' + s.replace("&", "&&").replace('"', '&"') + '"'
+
+
+def _format_double(x):
+    # Matches the default formatting of std::ostream.
+    if math.isnan(x):
+        return "-nan" if math.copysign(1.0, x) < 0 else "nan"
+    if math.isinf(x):
+        return "-inf" if x < 0 else "inf"
+    return "%g" % x
+
+
+def to_csv(path, out, header=True):
+    """Write every row as CSV, optionally preceded by the header."""
+    wrote_header = not header
+    for strings, columns in read_groups(path):
+        if not wrote_header:
+            out.write("".join(name + "," for name, _, _ in columns) + "\n")
+            wrote_header = True
+        formatters = []
+        for i, (name, column_type, values) in enumerate(columns):
+            if column_type == STRING:
+                if i == 0:
+                    cells = [_quote_path(s) for s in strings]
+                else:
+                    cells = ['"' + s + '"' for s in strings]
+                formatters.append(lambda v, cells=cells: cells[v])
+            elif column_type == FLOAT64:
+                formatters.append(_format_double)
+            else:
+                formatters.append(str)
+        for row in zip(*(values.tolist() for _, _, values in columns)):
+            out.write("".join(f(v) + "," for f, v in zip(formatters, row)) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert LCOM columnar output to CSV.")
+    parser.add_argument("input", type=str, help="A file written with --lcom:format columnar.")
+    parser.add_argument("-o", "--output", type=str, help="The CSV file to write. (default: standard output)")
+    parser.add_argument("--no-header", action="store_true", help="Do not write the header line.")
+    args = parser.parse_args()
+    if args.output:
+        with open(args.output, "w", newline="") as out:
+            to_csv(args.input, out, not args.no_header)
+    else:
+        to_csv(args.input, sys.stdout, not args.no_header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
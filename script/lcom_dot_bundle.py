@@ -0,0 +1,79 @@
+"""Read the DOT graphs bundled by --lcom:dot-bundle.
+
+See DOT::BundleSink in include/dot.hpp for the layout. Graphs are located
+through the index next to the bundle, so only the requested graph is read.
+
+List the bundled classes:
+    python3 script/lcom_dot_bundle.py output/lcom.dots
+Extract the graph of one class:
+    python3 script/lcom_dot_bundle.py output/lcom.dots c4 -o c4.dot
+Render the whole bundle, one image per graph:
+    dot -Tsvg -O output/lcom.dots
+"""
+
+import argparse
+import sys
+
+
+class Entry:
+    """Where a single graph is stored within the bundle."""
+
+    def __init__(self, offset, length, class_name, source_file):
+        self.offset = offset
+        self.length = length
+        self.class_name = class_name
+        self.source_file = source_file
+
+
+def read_index(path):
+    """Return the index entries of a bundle, in the order of the graphs."""
+    entries = []
+    with open(path + ".idx", encoding="utf-8", errors="surrogateescape") as f:
+        for line in f:
+            offset, length, class_name, source_file = line.rstrip("\n").split("\t", 3)
+            entries.append(Entry(int(offset), int(length), class_name, source_file))
+    return entries
+
+
+def read_graph(path, entry):
+    """Return the DOT source of a single graph."""
+    with open(path, "rb") as f:
+        f.seek(entry.offset)
+        data = f.read(entry.length)
+    if len(data) != entry.length:
+        raise ValueError(f"{path} is shorter than its index")
+    return data.decode("utf-8", "surrogateescape")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="List or extract bundled LCOM DOT graphs.")
+    parser.add_argument("bundle", type=str, help="A file written with --lcom:dot-bundle.")
+    parser.add_argument("classes", type=str, nargs="*",
+                        help="Names of the classes to extract. Lists every class if none are given.")
+    parser.add_argument("-o", "--output", type=str,
+                        help="The DOT file to write. (default: standard output)")
+    args = parser.parse_args()
+
+    entries = read_index(args.bundle)
+    if not args.classes:
+        for entry in entries:
+            print(f"{entry.class_name}\t{entry.source_file}")
+        return 0
+
+    graphs = []
+    for name in args.classes:
+        matches = [e for e in entries if e.class_name == name]
+        if not matches:
+            print(f"No graph for class {name} in {args.bundle}", file=sys.stderr)
+            return 1
+        graphs += [read_graph(args.bundle, e) for e in matches]
+    if args.output:
+        with open(args.output, "w", encoding="utf-8", errors="surrogateescape") as out:
+            out.write("".join(graphs))
+    else:
+        sys.stdout.write("".join(graphs))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
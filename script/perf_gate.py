@@ -0,0 +1,242 @@
+"""Performance regression gate.
+
+Measures the end-to-end pipeline on a fixed corpus and the LCOM kernel
+benchmarks, and compares the medians against a checked-in baseline. Fails if
+any measurement is slower or uses more memory than its baseline allows.
+
+Each baseline entry stores its median wall time in seconds and, for
+end-to-end entries, the peak RSS in bytes. Tolerances are relative, e.g. 0.25
+allows a measurement to be up to 25% above its baseline. A measurement without
+a baseline entry fails the gate, unless --allow-missing is given.
+
+Timings are only comparable on the machine the baseline was measured on, which
+is recorded in the baseline. A baseline without a machine has never been
+measured, and fails the gate. On any other machine, the comparison is skipped
+with exit status SKIPPED, which ctest reports as a skipped test, unless
+--ignore-machine is given.
+
+Check for regressions:
+    python3 script/perf_gate.py --lcom build/lcom.out --bench build/lcom-bench
+Update the baseline after an intended change, on the reference machine:
+    python3 script/perf_gate.py --lcom build/lcom.out --bench build/lcom-bench --update
+Both are also available through CMake as the lcom-perf test and the
+lcom-perf-update target.
+"""
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+PROJECT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_BASELINE = os.path.join(PROJECT, "script", "perf_baseline.json")
+# Directories within testcases/ analyzed end-to-end.
+CORPUS = ["simple-cases", "other-tests"]
+# Kernel benchmarks to gate on. Sizes are kept small so the gate stays fast,
+# especially for the quadratic kernels.
+BENCH_FILTER = (
+    "(LCOM3|LCOM4|LCOM5)/(int|Path)/(Uniform|PowerLaw)/(100|1000)$"
+    "|(LCOM1|GetNumSharedPairs)/(int|Path)/(Uniform|PowerLaw)/100$"
+)
+DEFAULT_TOLERANCES = {"time": 0.25, "memory": 0.10}
+
+
+def describe_machine():
+    """Identify the machine measurements are taken on."""
+    cpu = platform.processor() or platform.machine()
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    return {"cpu": cpu, "cpus": os.cpu_count(), "system": f"{platform.system()} {platform.machine()}"}
+
+
+def list_sources(directory):
+    sources = []
+    for root, _, files in os.walk(directory):
+        for name in files:
+            if name.endswith((".adb", ".cpp")):
+                sources.append(os.path.join(root, name))
+    return sorted(sources)
+
+
+def measure_e2e(lcom, directory, repetitions):
+    """Time lcom.out over every file in a directory.
+
+    Returns the sum of each file's median wall time and the largest peak RSS.
+    """
+    total = 0.0
+    peak = 0
+    with tempfile.TemporaryDirectory() as work_dir:
+        for source in list_sources(directory):
+            profile = os.path.join(work_dir, "profile.json")
+            cmd = [
+                lcom,
+                source,
+                "--lcom:debug",
+                "error",
+                "--lcom:class-type",
+                "All",
+                "--lcom:csv-output",
+                os.path.join(work_dir, "out.csv"),
+                "--lcom:profile",
+                profile,
+            ]
+            times = []
+            for _ in range(repetitions):
+                start = time.perf_counter()
+                result = subprocess.run(cmd, cwd=work_dir, stdout=subprocess.DEVNULL,
+                                        stderr=subprocess.DEVNULL)
+                times.append(time.perf_counter() - start)
+                if result.returncode != 0:
+                    raise RuntimeError(f"lcom.out failed on {source}")
+                with open(profile) as f:
+                    peak = max(peak, json.load(f).get("peakRssBytes", 0))
+            total += statistics.median(times)
+    return total, peak
+
+
+def measure_bench(bench, repetitions):
+    """Run the kernel benchmarks and return the median time of each, in seconds."""
+    cmd = [
+        bench,
+        f"--benchmark_filter={BENCH_FILTER}",
+        f"--benchmark_repetitions={repetitions}",
+        "--benchmark_report_aggregates_only=true",
+        "--benchmark_format=json",
+    ]
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, check=True)
+    medians = {}
+    scale = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+    for entry in json.loads(result.stdout)["benchmarks"]:
+        if entry.get("aggregate_name") != "median":
+            continue
+        medians[entry["run_name"]] = entry["real_time"] * scale[entry["time_unit"]]
+    return medians
+
+
+def measure(args):
+    measurements = {}
+    if args.lcom:
+        for directory in CORPUS:
+            print(f"Measuring lcom.out on {directory}", flush=True)
+            seconds, peak = measure_e2e(args.lcom, os.path.join(PROJECT, "testcases", directory),
+                                        args.repetitions)
+            measurements[f"e2e/{directory}"] = {"medianSeconds": seconds, "peakRssBytes": peak}
+    if args.bench:
+        print("Measuring kernel benchmarks", flush=True)
+        for name, seconds in measure_bench(args.bench, args.repetitions).items():
+            measurements[f"bench/{name}"] = {"medianSeconds": seconds}
+    return measurements
+
+
+def compare(baseline, measurements, time_tolerance=None, allow_missing=False):
+    """Print a report and return the names of all regressed measurements.
+
+    Measurements without a baseline entry count as regressions unless
+    allow_missing is set.
+    """
+    tolerances = dict(DEFAULT_TOLERANCES, **baseline.get("tolerances", {}))
+    if time_tolerance is not None:
+        tolerances["time"] = time_tolerance
+    entries = baseline.get("entries", {})
+    regressions = []
+    for name, measured in sorted(measurements.items()):
+        expected = entries.get(name)
+        if expected is None:
+            if allow_missing:
+                print(f"  WARNING {name} has no baseline entry and is not checked: {measured}")
+            else:
+                print(f"  MISSING {name} has no baseline entry: {measured}")
+                regressions.append(f"{name} (no baseline)")
+            continue
+        checks = [("medianSeconds", tolerances["time"]), ("peakRssBytes", tolerances["memory"])]
+        for key, tolerance in checks:
+            if key not in measured or not expected.get(key):
+                continue
+            ratio = measured[key] / expected[key]
+            status = "OK"
+            if ratio > 1 + tolerance:
+                status = "SLOW" if key == "medianSeconds" else "MEM"
+                regressions.append(f"{name} ({key})")
+            print(f"  {status:5} {name} {key}: {measured[key]:.6g} vs {expected[key]:.6g} "
+                  f"({(ratio - 1) * 100:+.1f}%, limit +{tolerance * 100:.0f}%)")
+    for name in sorted(set(entries) - set(measurements)):
+        print(f"  WARNING {name} was not measured")
+    return regressions
+
+
+# The exit status of a skipped comparison. Matches SKIP_RETURN_CODE of the
+# lcom-perf test.
+SKIPPED = 77
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check for performance regressions.")
+    parser.add_argument("--lcom", type=str, help="Path to lcom.out. Skips end-to-end runs if unset.")
+    parser.add_argument("--bench", type=str, help="Path to lcom-bench. Skips kernel runs if unset.")
+    parser.add_argument("--baseline", type=str, default=DEFAULT_BASELINE,
+                        help=f'Baseline file. (default: "{DEFAULT_BASELINE}")')
+    parser.add_argument("--repetitions", type=int, default=5,
+                        help="Runs per measurement. Medians are compared. (default: 5)")
+    parser.add_argument("--time-tolerance", type=float,
+                        help="Override the relative time tolerance from the baseline.")
+    parser.add_argument("--update", action="store_true",
+                        help="Replace the baseline entries with the new measurements, and record this "
+                        "machine as the reference. Entries measured on another machine are dropped.")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="Warn about measurements without a baseline entry instead of failing.")
+    parser.add_argument("--ignore-machine", action="store_true",
+                        help="Compare even if the baseline was measured on another machine.")
+    args = parser.parse_args()
+
+    baseline = {"tolerances": DEFAULT_TOLERANCES, "entries": {}}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    machine = describe_machine()
+    same_machine = baseline.get("machine") == machine
+    if not args.update and "machine" not in baseline:
+        print("ERROR: The baseline has not been measured on a reference machine yet, so there is "
+              "nothing to compare against. Generate it on the reference CI machine with --update "
+              "(the lcom-perf-update target) and commit it.", file=sys.stderr)
+        return 1
+    if not args.update and not same_machine and not args.ignore_machine:
+        print(f"SKIPPED: The baseline was measured on {baseline['machine']}, not on this machine "
+              f"({machine}). Run the gate on the reference machine, or pass --ignore-machine.",
+              file=sys.stderr)
+        return SKIPPED
+
+    measurements = measure(args)
+
+    if args.update:
+        if not same_machine:
+            baseline["entries"] = {}
+        baseline["machine"] = machine
+        baseline.setdefault("entries", {}).update(measurements)
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Updated {len(measurements)} entries in {args.baseline}")
+        return 0
+
+    regressions = compare(baseline, measurements, args.time_tolerance, args.allow_missing)
+    if regressions:
+        print("Performance regressions: " + ", ".join(regressions), file=sys.stderr)
+        return 1
+    print("No performance regressions.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,116 @@
+"""Run lcom.out over a generated corpus and record time and memory by size.
+
+Generates a corpus with gen_corpus.py (accepting the same shape arguments),
+runs lcom.out on every file with --lcom:profile, and writes one CSV row per
+file to <out>/scaling.csv with the shape of the class, the total wall time,
+the peak RSS and the wall time of each analysis phase.
+Exits with a non-zero status if lcom.out fails on any file.
+
+Example:
+    python3 script/scale_bench.py --exe build/lcom.out --out output/scaling \\
+        --methods 10,100,1000,10000 --languages ada
+"""
+
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+import time
+
+import gen_corpus
+
+# The class type to analyze for each language.
+CLASS_TYPES = {"ada": "Package", "cpp": "Class"}
+# Phases reported as their own columns.
+PHASES = [
+    "Frontend",
+    "RenamingTraversal",
+    "VisitorTraversal",
+    "Filter",
+    "ToLCOMClass",
+    "ReleaseAST",
+    "LCOM1",
+    "LCOM2",
+    "LCOM3",
+    "LCOM4",
+    "LCOM5",
+    "CSVOutput",
+]
+SHAPE = ["language", "methods", "attributes", "depth", "renamings", "calls", "accesses"]
+
+
+def run_one(exe, entry, work_dir, extra_args):
+    """Analyze a single file and return its CSV row."""
+    base = os.path.join(work_dir, os.path.basename(entry["file"]))
+    profile = base + ".profile.json"
+    cmd = [
+        exe,
+        entry["file"],
+        "--lcom:debug",
+        "error",
+        "--lcom:class-type",
+        CLASS_TYPES[entry["language"]],
+        "--lcom:csv-output",
+        base + ".csv",
+        "--lcom:profile",
+        profile,
+    ] + extra_args
+    start = time.perf_counter()
+    with open(base + ".log", "w") as log:
+        result = subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT, cwd=work_dir)
+    elapsed = time.perf_counter() - start
+
+    row = {key: entry[key] for key in SHAPE}
+    row["file"] = os.path.basename(entry["file"])
+    row["returnCode"] = result.returncode
+    row["wallSeconds"] = f"{elapsed:.6f}"
+    if result.returncode == 0 and os.path.exists(profile):
+        with open(profile) as f:
+            data = json.load(f)
+        row["peakRssBytes"] = data.get("peakRssBytes", "")
+        totals = data.get("totals", {})
+        for phase in PHASES:
+            if phase in totals:
+                row[phase] = f"{totals[phase]['wallSeconds']:.6f}"
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure lcom.out scaling on a synthetic corpus.")
+    gen_corpus.add_arguments(parser)
+    parser.add_argument("--exe", type=str, required=True,
+                        help="Path to lcom.out.")
+    parser.add_argument("--args", type=str, default="",
+                        help="Additional arguments passed to lcom.out.")
+    args = parser.parse_args()
+
+    entries = gen_corpus.generate(
+        os.path.join(args.out, "corpus"), args.languages.split(","), args.methods,
+        args.attributes, args.depth, args.renamings, args.calls, args.accesses,
+        args.seed)
+    work_dir = os.path.join(args.out, "workingDir-scaling")
+    os.makedirs(work_dir, exist_ok=True)
+
+    rows = []
+    for entry in entries:
+        print(f"Analyzing {entry['file']}", flush=True)
+        rows.append(run_one(os.path.abspath(args.exe), entry, work_dir, args.args.split()))
+
+    fields = ["file"] + SHAPE + ["returnCode", "wallSeconds", "peakRssBytes"] + PHASES
+    with open(os.path.join(args.out, "scaling.csv"), "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=fields)
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"Saved results to {os.path.join(args.out, 'scaling.csv')}")
+
+    failures = [row["file"] for row in rows if row["returnCode"] != 0]
+    if failures:
+        print("lcom.out failed on: " + ", ".join(failures), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
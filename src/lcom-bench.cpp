@@ -0,0 +1,487 @@
+// Micro-benchmarks for the LCOM metrics in lcom.hpp, and for the handler
+// dispatch of the traversals in traverse.hpp.
+// The classes are generated synthetically, so ROSE is not needed. Methods and
+// classes are plain ints, and attributes are either ints or record paths that
+// behave like AType under DotBehavior::Full.
+//
+// Run all benchmarks, or filter them, e.g.:
+//   build/lcom-bench --benchmark_filter='LCOM3/Path/PowerLaw'
+// Kernels that compare every pair of methods (LCOM1, LCOM2 and
+// GetNumSharedPairs) are quadratic and only run up to 1000 methods by default.
+// Pass --pairwise-max=100000 to run them over the full range.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lcom.hpp"
+#include "variant-table.hpp"
+
+namespace {
+
+// A record path, such as a.b.c.
+// Like AType, paths compare equal when one is a prefix of the other, so an
+// access to a record overlaps every access to the fields within it.
+struct Path {
+  using T = int;
+  std::vector<int> ids;
+
+  std::vector<int>::const_iterator cbegin() const { return ids.cbegin(); }
+  std::vector<int>::const_iterator cend() const { return ids.cend(); }
+  friend bool operator==(const Path& lhs, const Path& rhs) {
+    const auto size = std::min(lhs.ids.size(), rhs.ids.size());
+    return std::equal(lhs.ids.cbegin(), lhs.ids.cbegin() + size,
+                      rhs.ids.cbegin());
+  }
+  friend bool operator<(const Path& lhs, const Path& rhs) {
+    if (lhs.ids.size() != rhs.ids.size())
+      return lhs.ids.size() < rhs.ids.size();
+    return lhs.ids < rhs.ids;
+  }
+  friend std::ostream& operator<<(std::ostream& os, const Path& path) {
+    for (auto it = path.ids.cbegin(); it != path.ids.cend(); ++it) {
+      os << (it == path.ids.cbegin() ? "" : ".") << *it;
+    }
+    return os;
+  }
+};
+
+// How methods pick the attributes they access.
+enum class Shape {
+  // Every attribute is equally likely.
+  Uniform,
+  // A few attributes are accessed by most methods.
+  PowerLaw,
+  // Methods form small groups that mostly share attributes among themselves.
+  Clustered,
+  // Like Uniform, but every access is a deep record path.
+  DeepPath
+};
+
+const char* ShapeName(const Shape shape) {
+  switch (shape) {
+    case Shape::Uniform:
+      return "Uniform";
+    case Shape::PowerLaw:
+      return "PowerLaw";
+    case Shape::Clustered:
+      return "Clustered";
+    case Shape::DeepPath:
+      return "DeepPath";
+  }
+  return "";
+}
+
+// Attributes accessed per method.
+constexpr int attributesPerMethod = 4;
+// Methods called per method.
+constexpr int callsPerMethod = 1;
+// Methods per group for Shape::Clustered.
+constexpr int clusterSize = 16;
+// Record depth and fields per record for paths.
+constexpr int shallowDepth = 2;
+constexpr int deepDepth = 8;
+constexpr int fieldsPerRecord = 4;
+
+template <typename V>
+V MakeAttribute(int root, int depth, std::mt19937& rng);
+
+template <>
+int MakeAttribute<int>(int root, int, std::mt19937&) {
+  return root;
+}
+
+template <>
+Path MakeAttribute<Path>(int root, int depth, std::mt19937& rng) {
+  std::uniform_int_distribution<int> field(0, fieldsPerRecord - 1);
+  Path path{{root}};
+  // Access anywhere from the whole record down to its deepest field.
+  const int length = std::uniform_int_distribution<int>(1, depth)(rng);
+  for (int i = 1; i < length; ++i) path.ids.push_back(field(rng));
+  return path;
+}
+
+template <typename V>
+using BenchClass = LCOM::Class<int, int, V>;
+
+// Generate a class with the given number of methods. The same arguments
+// always produce the same class.
+template <typename V>
+BenchClass<V> Generate(const Shape shape, const int numMethods) {
+  std::mt19937 rng(numMethods);
+  const int numAttributes = std::max(1, numMethods / 2);
+  const int depth = shape == Shape::DeepPath ? deepDepth : shallowDepth;
+
+  std::uniform_int_distribution<int> anyAttribute(0, numAttributes - 1);
+  std::uniform_int_distribution<int> anyMethod(0, numMethods - 1);
+  std::discrete_distribution<int> powerLaw;
+  if (shape == Shape::PowerLaw) {
+    std::vector<double> weights(numAttributes);
+    for (int i = 0; i < numAttributes; ++i) {
+      weights[i] = 1.0 / std::pow(i + 1, 1.2);
+    }
+    powerLaw =
+        std::discrete_distribution<int>(weights.cbegin(), weights.cend());
+  }
+  std::bernoulli_distribution crossCluster(0.05);
+
+  BenchClass<V> classInst(0);
+  for (int m = 0; m < numMethods; ++m) {
+    LCOM::Method<int, V> method(m);
+    for (int a = 0; a < attributesPerMethod; ++a) {
+      int root = 0;
+      switch (shape) {
+        case Shape::Uniform:
+        case Shape::DeepPath:
+          root = anyAttribute(rng);
+          break;
+        case Shape::PowerLaw:
+          root = powerLaw(rng);
+          break;
+        case Shape::Clustered: {
+          // Each cluster of methods owns a slice of the attributes.
+          const int clusterAttributes = clusterSize / 2;
+          const int first = (m / clusterSize) * clusterAttributes;
+          root = crossCluster(rng)
+                     ? anyAttribute(rng)
+                     : (first + std::uniform_int_distribution<int>(
+                                    0, clusterAttributes - 1)(rng)) %
+                           numAttributes;
+          break;
+        }
+      }
+      method.attributes.insert(MakeAttribute<V>(root, depth, rng));
+    }
+    for (int c = 0; c < callsPerMethod; ++c) {
+      int callee = anyMethod(rng);
+      if (shape == Shape::Clustered && !crossCluster(rng)) {
+        const int first = (m / clusterSize) * clusterSize;
+        callee = std::min(numMethods - 1, first + callee % clusterSize);
+      }
+      if (callee != m) method.calledMethods.emplace_back(callee);
+    }
+    classInst.methods.insert(method);
+  }
+  return classInst;
+}
+
+template <typename V>
+using Kernel = std::function<std::size_t(const BenchClass<V>&)>;
+
+template <typename V>
+void Run(benchmark::State& state, const Shape shape, const Kernel<V>& kernel) {
+  const int numMethods = static_cast<int>(state.range(0));
+  const BenchClass<V> classInst = Generate<V>(shape, numMethods);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernel(classInst));
+  }
+  state.SetComplexityN(numMethods);
+  state.counters["methods"] = numMethods;
+}
+
+// The largest class size used for quadratic kernels.
+long pairwiseMax = 1000;
+
+// Register a kernel for every shape that applies to V.
+template <typename V>
+void Register(const std::string& kernelName, const char* attributeName,
+              const Kernel<V>& kernel, const bool quadratic) {
+  std::vector<Shape> shapes = {Shape::Uniform, Shape::PowerLaw,
+                               Shape::Clustered};
+  if (std::is_same<V, Path>::value) shapes.push_back(Shape::DeepPath);
+  for (const Shape shape : shapes) {
+    const std::string name =
+        kernelName + "/" + attributeName + "/" + ShapeName(shape);
+    benchmark::RegisterBenchmark(name.c_str(),
+                                 [shape, kernel](benchmark::State& state) {
+                                   Run<V>(state, shape, kernel);
+                                 })
+        ->RangeMultiplier(10)
+        ->Range(10, quadratic ? std::min(pairwiseMax, 100000L) : 100000)
+        ->Unit(benchmark::kMicrosecond)
+        ->Complexity();
+  }
+}
+
+template <typename V>
+void RegisterAll(const char* attributeName) {
+  Register<V>(
+      "LCOM1", attributeName,
+      [](const BenchClass<V>& c) { return LCOM::LCOM1(c); }, true);
+  Register<V>(
+      "LCOM2", attributeName,
+      [](const BenchClass<V>& c) { return LCOM::LCOM2(c); }, true);
+  Register<V>(
+      "LCOM3", attributeName,
+      [](const BenchClass<V>& c) { return LCOM::LCOM3(c); }, false);
+  Register<V>(
+      "LCOM4", attributeName,
+      [](const BenchClass<V>& c) { return LCOM::LCOM4(c); }, false);
+  Register<V>(
+      "LCOM5", attributeName,
+      [](const BenchClass<V>& c) {
+        return static_cast<std::size_t>(LCOM::LCOM5(c) * 1000);
+      },
+      false);
+  Register<V>(
+      "GetLCOM3Set", attributeName,
+      [](const BenchClass<V>& c) {
+        return BenchClass<V>::GetLCOM3Set(c).GetNumSets();
+      },
+      false);
+  Register<V>(
+      "GetNumSharedPairs", attributeName,
+      [](const BenchClass<V>& c) { return LCOM::GetNumSharedPairs(c.methods); },
+      true);
+}
+
+// Handler dispatch in the traversals.
+// Each visited node used to be tested against a cascade of is<T> checks, and
+// is now looked up in a VariantTable (see variant-table.hpp). ROSE's is<T>
+// reads the node's variant through a virtual call and tests one bit of the
+// class hierarchy cast table, which is modeled here on a synthetic hierarchy
+// of the same size as ROSE's. The table is the one the traversals use, built
+// over that hierarchy instead of ROSE's.
+
+// About as many variants as ROSE has node types (node-types.txt).
+constexpr int numVariants = 675;
+
+// A node whose variant is read through a virtual call, like SgNode::variantT().
+struct Node {
+  virtual ~Node() {}
+  virtual int variantT() const = 0;
+};
+// Two node classes, so calls to variantT() cannot be devirtualized.
+struct NodeA : Node {
+  const int v;
+  explicit NodeA(int v) : v(v) {}
+  int variantT() const override { return v; }
+};
+struct NodeB : Node {
+  const int v;
+  explicit NodeB(int v) : v(v) {}
+  int variantT() const override { return v; }
+};
+
+// A random class hierarchy with the same cast table layout as ROSE's:
+// one bit per (variant, ancestor or self) pair.
+struct Hierarchy {
+  // The Variants interface of Traverse::BasicVariantTable.
+  using Variant = int;
+  static constexpr std::size_t count = numVariants;
+
+  std::vector<int> parent;
+  std::vector<std::vector<unsigned char>> castTable;
+  std::vector<std::vector<int>> children;
+
+  Hierarchy() : parent(numVariants, -1), children(numVariants) {
+    std::mt19937 rng(numVariants);
+    for (int v = 1; v < numVariants; ++v) {
+      parent[v] = std::uniform_int_distribution<int>(0, v - 1)(rng);
+      children[parent[v]].push_back(v);
+    }
+    castTable.assign(numVariants,
+                     std::vector<unsigned char>(numVariants / 8 + 1, 0));
+    for (int v = 0; v < numVariants; ++v) {
+      for (int a = v; a != -1; a = parent[a]) {
+        castTable[v][a >> 3] |= 1 << (a & 7);
+      }
+    }
+  }
+
+  // Like ROSE's isSgXxx(): a virtual call and a bit test.
+  const Node* Is(const Node* n, const int target) const {
+    return n && (castTable[n->variantT()][target >> 3] & (1 << (target & 7)))
+               ? n
+               : nullptr;
+  }
+
+  // The variant itself and every variant derived from it, like VariantVector.
+  std::vector<int> Derived(const int v) const {
+    std::vector<int> derived{v};
+    for (std::size_t i = 0; i < derived.size(); ++i) {
+      for (const int c : children[derived[i]]) derived.push_back(c);
+    }
+    return derived;
+  }
+};
+
+template <typename H>
+using VariantTable = Traverse::BasicVariantTable<H, Hierarchy>;
+
+// The handlers of VisitorTraversal, in priority order, and the expression
+// types HandleExpression() suppresses.
+struct Targets {
+  // Method, AdaRenamingRefExp, VarRefExp, FunctionRefExp,
+  // MemberFunctionRefExp, Expression and CtorInitializerList.
+  std::vector<int> handlers;
+  std::vector<int> suppressed;
+  int expression = 0;
+  // The number of the Expression handler, counting from 1.
+  std::size_t expressionHandler = 0;
+};
+
+Targets PickTargets(const Hierarchy& hierarchy) {
+  // The expression base is the variant with the largest proper subtree, as
+  // SgExpression is in ROSE.
+  Targets targets;
+  std::size_t largest = 0;
+  for (int v = 1; v < numVariants; ++v) {
+    const std::size_t size = hierarchy.Derived(v).size();
+    if (size > largest && size < numVariants / 2) {
+      largest = size;
+      targets.expression = v;
+    }
+  }
+  const std::vector<int> expressions = hierarchy.Derived(targets.expression);
+  std::vector<int> others;
+  for (int v = 1; v < numVariants; ++v) {
+    if (std::find(expressions.cbegin(), expressions.cend(), v) ==
+        expressions.cend())
+      others.push_back(v);
+  }
+  // Reference expressions are the last (most derived) expression types, and
+  // the suppressed ones are taken from the rest.
+  const auto ref = [&](std::size_t i) {
+    return expressions[expressions.size() - 1 - i];
+  };
+  targets.handlers = {others[others.size() / 3], ref(0), ref(1), ref(2),
+                      ref(3), targets.expression,
+                      others[2 * others.size() / 3]};
+  targets.expressionHandler =
+      std::find(targets.handlers.cbegin(), targets.handlers.cend(),
+                targets.expression) -
+      targets.handlers.cbegin() + 1;
+  const std::size_t step = std::max<std::size_t>(1, expressions.size() / 16);
+  for (std::size_t i = 1;
+       i < expressions.size() && targets.suppressed.size() < 16; i += step) {
+    targets.suppressed.push_back(expressions[i]);
+  }
+  return targets;
+}
+
+// A stream of visited nodes. About half of the nodes of an AST are
+// expressions, the rest are statements, declarations, types and support
+// nodes.
+std::vector<std::unique_ptr<Node>> MakeNodes(const Hierarchy& hierarchy,
+                                             const Targets& targets,
+                                             const std::size_t count) {
+  const std::vector<int> expressions = hierarchy.Derived(targets.expression);
+  std::mt19937 rng(count);
+  std::bernoulli_distribution isExpression(0.5);
+  std::uniform_int_distribution<std::size_t> anyExpression(
+      0, expressions.size() - 1);
+  std::uniform_int_distribution<int> anyVariant(0, numVariants - 1);
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (std::size_t i = 0; i < count; ++i) {
+    const int v =
+        isExpression(rng) ? expressions[anyExpression(rng)] : anyVariant(rng);
+    if (i % 2)
+      nodes.emplace_back(new NodeA(v));
+    else
+      nodes.emplace_back(new NodeB(v));
+  }
+  return nodes;
+}
+
+constexpr std::size_t dispatchNodes = 1 << 16;
+
+// The is<T> cascade, including the one in HandleExpression().
+void DispatchCascade(benchmark::State& state) {
+  const Hierarchy hierarchy;
+  const Targets targets = PickTargets(hierarchy);
+  const auto nodes = MakeNodes(hierarchy, targets, dispatchNodes);
+  for (auto _ : state) {
+    std::size_t sum = 0;
+    for (const auto& node : nodes) {
+      const Node* n = node.get();
+      std::size_t handler = 0;
+      for (std::size_t h = 0; h < targets.handlers.size(); ++h) {
+        if (hierarchy.Is(n, targets.handlers[h])) {
+          handler = h + 1;
+          break;
+        }
+      }
+      if (handler == targets.expressionHandler) {
+        for (const int t : targets.suppressed) {
+          if (hierarchy.Is(n, t)) {
+            handler = targets.handlers.size() + 1;
+            break;
+          }
+        }
+      }
+      sum += handler;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+
+// The VariantTable lookups that replaced it.
+void DispatchTable(benchmark::State& state) {
+  const Hierarchy hierarchy;
+  const Targets targets = PickTargets(hierarchy);
+  const auto nodes = MakeNodes(hierarchy, targets, dispatchNodes);
+  // Handlers are numbered from 1 in priority order, as in the cascade.
+  std::vector<std::pair<int, std::size_t>> handlerEntries;
+  for (std::size_t i = 0; i < targets.handlers.size(); ++i) {
+    handlerEntries.emplace_back(targets.handlers[i], i + 1);
+  }
+  std::vector<std::pair<int, bool>> suppressedEntries;
+  for (const int t : targets.suppressed) suppressedEntries.emplace_back(t, true);
+  const VariantTable<std::size_t> handlers(0, handlerEntries, hierarchy);
+  const VariantTable<bool> suppressed(false, suppressedEntries, hierarchy);
+  for (auto _ : state) {
+    std::size_t sum = 0;
+    for (const auto& node : nodes) {
+      const Node* n = node.get();
+      std::size_t handler = handlers[n];
+      if (handler == targets.expressionHandler && suppressed[n])
+        handler = targets.handlers.size() + 1;
+      sum += handler;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Only report problems, as the metrics log at INFO and DEBUG.
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::warning);
+  // Strip our own flag before Google Benchmark sees the arguments.
+  const std::string pairwiseFlag = "--pairwise-max=";
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, pairwiseFlag.size(), pairwiseFlag) == 0) {
+      pairwiseMax = std::stol(arg.substr(pairwiseFlag.size()));
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+  RegisterAll<int>("int");
+  RegisterAll<Path>("Path");
+  benchmark::RegisterBenchmark("Dispatch/Cascade", DispatchCascade)
+      ->Unit(benchmark::kMicrosecond);
+  benchmark::RegisterBenchmark("Dispatch/Table", DispatchTable)
+      ->Unit(benchmark::kMicrosecond);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
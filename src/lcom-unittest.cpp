@@ -8,15 +8,19 @@
 #include <boost/optional.hpp>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <ostream>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "anonymize.hpp"
 #include "define.hpp"
 #include "lcom.hpp"
+#include "output.hpp"
 #include "traverse.hpp"
 
 // using Class = SgAdaPackageSpec*;
@@ -32,6 +36,24 @@ const boost::filesystem::path EXEC = ROOT / "build/lcom.out";
 // Used to find specific test files used in unit testing.
 const boost::filesystem::path TESTS = ROOT / "testcases";
 
+// Parsing dominates the run time of the suite, and most sources are checked
+// by several cases (each DotBehavior, tree walk and memory pool scan), so each
+// source is parsed once per process and its project reused. Extraction only
+// reads the AST, so a cached project is valid for any settings.
+class ProjectCache {
+ public:
+  static SgProject* Get(const boost::filesystem::path& source) {
+    static std::map<std::string, SgProject*> projects;
+    const std::string key = boost::filesystem::weakly_canonical(source).string();
+    auto it = projects.find(key);
+    if (it != projects.end()) return it->second;
+    std::vector<std::string> cmdLineArgs{EXEC.string(), source.string()};
+    SgProject* project = Traverse::GetProject(cmdLineArgs);
+    projects.emplace(key, project);
+    return project;
+  }
+};
+
 struct LCOMData {
   struct LCOMClass {
     const std::size_t LCOM1;
@@ -68,28 +90,6 @@ struct LCOMClassData {
   }
 };
 
-class LCOMTest : public ::testing::TestWithParam<LCOMClassData> {
- protected:
-  SgProject* project;
-  // Unfortunately, these must be specified for each class type you want to
-  // evaluate. This is a limitation in the way GTests support templated code.
-  std::vector<LCOM::Class<SgAdaPackageSpec*, Method, Attribute>>
-      LCOMInputPackage;
-  std::vector<LCOM::Class<SgAdaProtectedSpec*, Method, Attribute>>
-      LCOMInputProtected;
-  std::vector<LCOM::Class<SgClassDeclaration*, Method, Attribute>>
-      LCOMInputClass;
-  std::vector<LCOM::Class<SgNamespaceDeclarationStatement*, Method, Attribute>>
-      LCOMInputNamespace;
-
-  void SetUpProject(const boost::filesystem::path& source, DotBehavior dot, bool filterUndefined) {
-    std::vector<std::string> cmdLineArgs{EXEC.string(), source.string()};
-    dotBehavior = dot;
-    filterUndefinedMethods = filterUndefined;
-    project = Traverse::GetProject(cmdLineArgs);
-  }
-};
-
 template <typename C>
 void CheckLCOMInput(const std::vector<LCOM::Class<C, Method, Attribute>>& input,
                     const LCOMData& exp) {
@@ -117,26 +117,134 @@ void CheckLCOMInput(const std::vector<LCOM::Class<C, Method, Attribute>>& input,
   }
 }
 
-TEST_P(LCOMTest, CheckClass) {
-  LCOMClassData exp = GetParam();
-  SetUpProject(exp.source, exp.dot, exp.filterUndefinedMethods);
-  if (exp.PackageData != boost::none) {
-    LCOMInputPackage = Traverse::GetClassData<SgAdaPackageSpec*>(project);
-    CheckLCOMInput(LCOMInputPackage, *(exp.PackageData));
-  }
-  if (exp.ProtectedData != boost::none) {
-    LCOMInputProtected = Traverse::GetClassData<SgAdaProtectedSpec*>(project);
-    CheckLCOMInput(LCOMInputProtected, *(exp.ProtectedData));
+class LCOMTest : public ::testing::TestWithParam<LCOMClassData> {
+ protected:
+  SgProject* project;
+  // Unfortunately, these must be specified for each class type you want to
+  // evaluate. This is a limitation in the way GTests support templated code.
+  std::vector<LCOM::Class<SgAdaPackageSpec*, Method, Attribute>>
+      LCOMInputPackage;
+  std::vector<LCOM::Class<SgAdaProtectedSpec*, Method, Attribute>>
+      LCOMInputProtected;
+  std::vector<LCOM::Class<SgClassDeclaration*, Method, Attribute>>
+      LCOMInputClass;
+  std::vector<LCOM::Class<SgNamespaceDeclarationStatement*, Method, Attribute>>
+      LCOMInputNamespace;
+
+  // Only the parsed projects are shared on purpose. There is no per-test
+  // extraction context: the IA maps and the settings in define.hpp are
+  // process-wide, so the tests of a process must not run concurrently. GTest
+  // runs them one after another, and each test resets that state before and
+  // after it runs, so its results do not depend on the tests before it.
+  static void ResetExtraction() {
+    Traverse::IA<SgAdaPackageSpec*>::Clear();
+    Traverse::IA<SgAdaProtectedSpec*>::Clear();
+    Traverse::IA<SgClassDeclaration*>::Clear();
+    Traverse::IA<SgNamespaceDeclarationStatement*>::Clear();
+    dotBehavior = DotBehavior::LeftOnly;
+    filterUndefinedMethods = false;
+    extraction = Extraction::TreeWalk;
   }
-  if (exp.ClassData != boost::none) {
-    LCOMInputClass = Traverse::GetClassData<SgClassDeclaration*>(project);
-    CheckLCOMInput(LCOMInputClass, *(exp.ClassData));
+
+  void SetUp() override { ResetExtraction(); }
+
+  void TearDown() override { ResetExtraction(); }
+
+  void SetUpProject(const boost::filesystem::path& source, DotBehavior dot, bool filterUndefined) {
+    dotBehavior = dot;
+    filterUndefinedMethods = filterUndefined;
+    project = ProjectCache::Get(source);
   }
-  if (exp.NamespaceData != boost::none) {
-    LCOMInputNamespace = Traverse::GetClassData<SgNamespaceDeclarationStatement*>(project);
-    CheckLCOMInput(LCOMInputNamespace, *(exp.NamespaceData));
+
+  void CheckClasses() {
+    LCOMClassData exp = GetParam();
+    SetUpProject(exp.source, exp.dot, exp.filterUndefinedMethods);
+    if (exp.PackageData != boost::none) {
+      LCOMInputPackage = Traverse::GetClassData<SgAdaPackageSpec*>(project);
+      CheckLCOMInput(LCOMInputPackage, *(exp.PackageData));
+    }
+    if (exp.ProtectedData != boost::none) {
+      LCOMInputProtected = Traverse::GetClassData<SgAdaProtectedSpec*>(project);
+      CheckLCOMInput(LCOMInputProtected, *(exp.ProtectedData));
+    }
+    if (exp.ClassData != boost::none) {
+      LCOMInputClass = Traverse::GetClassData<SgClassDeclaration*>(project);
+      CheckLCOMInput(LCOMInputClass, *(exp.ClassData));
+    }
+    if (exp.NamespaceData != boost::none) {
+      LCOMInputNamespace = Traverse::GetClassData<SgNamespaceDeclarationStatement*>(project);
+      CheckLCOMInput(LCOMInputNamespace, *(exp.NamespaceData));
+    }
+    return;
   }
-  return;
+};
+
+TEST_P(LCOMTest, CheckClass) {
+  extraction = Extraction::TreeWalk;
+  CheckClasses();
+}
+
+// The memory pool scan is expected to produce the same class data as the tree
+// walk, so it is checked against the same expected values.
+TEST_P(LCOMTest, CheckClassMemoryPool) {
+  extraction = Extraction::MemoryPool;
+  CheckClasses();
+}
+
+// Anonymized IDs are joined across runs and machines, so the hash must match
+// the reference XXH64 exactly.
+TEST(AnonymizeTest, MatchesXXH64) {
+  const auto hash = [](const std::string& s, std::uint64_t seed) {
+    return Anonymize::XXH64(s.data(), s.size(), seed);
+  };
+  EXPECT_EQ(hash("", 0), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(hash("a", 0), 0xD24EC4F1A98C6E5BULL);
+  EXPECT_EQ(hash("abc", 0), 0x44BC2CF5AD770999ULL);
+  EXPECT_EQ(hash("Nobody inspects the spammish repetition", 0),
+            0xFBCEA83C8A378BF1ULL);
+
+  Anonymize::SetKey("");
+  EXPECT_EQ(Anonymize::Hash("abc"), std::to_string(0x44BC2CF5AD770999ULL));
+  const boost::filesystem::path unkeyed = Anonymize::Path("/a/b");
+  Anonymize::SetKey("key");
+  EXPECT_NE(Anonymize::Hash("abc"), std::to_string(0x44BC2CF5AD770999ULL));
+  // Components cached under another key must not be reused.
+  EXPECT_NE(Anonymize::Path("/a/b"), unkeyed);
+  Anonymize::SetKey("");
+}
+
+// Keyed IDs must match the reference SipHash-2-4, with the key 00..0f and the
+// messages 00, 00 01, ...
+TEST(AnonymizeTest, MatchesSipHash24) {
+  unsigned char bytes[64];
+  for (int i = 0; i < 64; i++) bytes[i] = i;
+  const std::uint64_t k0 = 0x0706050403020100ULL;
+  const std::uint64_t k1 = 0x0F0E0D0C0B0A0908ULL;
+  EXPECT_EQ(Anonymize::SipHash24(bytes, 0, k0, k1), 0x726FDB47DD0E0E31ULL);
+  EXPECT_EQ(Anonymize::SipHash24(bytes, 1, k0, k1), 0x74F839C593DC67FDULL);
+  EXPECT_EQ(Anonymize::SipHash24(bytes, 15, k0, k1), 0xA129CA6149BE45E5ULL);
+  EXPECT_EQ(Anonymize::SipHash24(bytes, 63, k0, k1), 0x958A324CEB064572ULL);
+}
+
+// A run writes a single metrics sink, so naming several formats must fail
+// instead of silently keeping the last one.
+TEST(OutputsTest, RejectsSeveralMetricsFormats) {
+  Output::Selection selection;
+  EXPECT_TRUE(Output::ParseOutputs("csv,dot", selection));
+  EXPECT_TRUE(selection.metrics);
+  EXPECT_TRUE(selection.dot);
+  ASSERT_TRUE(selection.format);
+  EXPECT_EQ(*selection.format, Output::Format::CSV);
+
+  selection = Output::Selection();
+  EXPECT_TRUE(Output::ParseOutputs("jsonl,metrics,jsonl", selection));
+  ASSERT_TRUE(selection.format);
+  EXPECT_EQ(*selection.format, Output::Format::JSONL);
+
+  selection = Output::Selection();
+  EXPECT_FALSE(Output::ParseOutputs("csv,jsonl", selection));
+  selection = Output::Selection();
+  EXPECT_FALSE(Output::ParseOutputs("metrics,svg", selection));
 }
 
 // Structure of a test:
@@ -1,20 +1,29 @@
 #include "rose.h"
 // Always include ROSE first.
 
-#include <Rose/CommandLine.h>
 #include <Sawyer/CommandLine.h>
 #include "sageInterface.h"
 
 #include <boost/filesystem.hpp>
 #include <cassert>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 
 #include "aixlog.hpp"
+#include "asynclog.hpp"
 #include "define.hpp"
+#include "dot.hpp"
 #include "lcom.hpp"
+#include "options.hpp"
+#include "output.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include "traverse.hpp"
 
 namespace si = SageInterface;
@@ -30,33 +39,29 @@ static const char* description =
 
 struct Settings {
   boost::filesystem::path csvPath;
+  // A CSV file shared with other processes, appended to instead of writing
+  // csvPath.
+  boost::filesystem::path sharedPath;
   ClassType classType = ClassType::Default;
+  // Append memory usage columns to each CSV row.
+  bool memoryColumns = false;
+  // Do not print the metrics of each class to standard output.
+  bool quiet = false;
+  Output::Format format = Output::Format::CSV;
+  // The outputs to write, as given to --lcom:outputs. SelectOutputs sets the
+  // fields below from it.
+  std::string outputs = "metrics";
+  bool metricsOutput = true;
+  bool dotOutput = false;
+  boost::filesystem::path dotPath;
+  // A single file holding every graph, written instead of dotPath.
+  boost::filesystem::path bundlePath;
 };
 
 std::tuple<std::vector<std::string>, Settings> parseArgs(
     std::vector<std::string> args, Settings settings, int argc, char* argv[]) {
   namespace scl = Sawyer::CommandLine;
-  scl::Parser p =
-      Rose::CommandLine::createEmptyParserStage(purpose, description);
-  p.with(Rose::CommandLine::genericSwitches());
-
-  // Create a group of switches specific to this tool
-  scl::SwitchGroup lcomArgs("Lack of Cohesion of Methods (LCOM) switches");
-  lcomArgs.name("lcom");
-  lcomArgs.insert(scl::Switch("debug")
-                      .argument("[trace|debug|info|notice|warning|error|fatal]",
-                                scl::enumParser<AixLog::Severity>(debug)
-                                    ->with("trace", AixLog::Severity::trace)
-                                    ->with("debug", AixLog::Severity::debug)
-                                    ->with("info", AixLog::Severity::info)
-                                    ->with("notice", AixLog::Severity::notice)
-                                    ->with("warning", AixLog::Severity::warning)
-                                    ->with("error", AixLog::Severity::error)
-                                    ->with("fatal", AixLog::Severity::fatal))
-                      .doc("Specifies a logging severity level."));
-  lcomArgs.insert(scl::Switch("anonymous")
-                      .intrinsicValue("true", scl::booleanParser(anonymous))
-                      .doc("Disable component name resolution."));
+  scl::SwitchGroup lcomArgs = Options::CommonSwitches(settings.classType);
   lcomArgs.insert(
       scl::Switch("csv-output", 'o')
           .argument("filename", scl::anyParser(settings.csvPath))
@@ -64,61 +69,84 @@ std::tuple<std::vector<std::string>, Settings> parseArgs(
                "file is stored in the same directory as the analyzed file, "
                "under the name \"<sourceName>.adb.csv\"."));
   lcomArgs.insert(
-      scl::Switch("dot-behavior")
-          .argument("[LeftOnly|Full]",
-                    scl::enumParser<DotBehavior>(dotBehavior)
-                        ->with("LeftOnly", DotBehavior::LeftOnly)
-                        ->with("Full", DotBehavior::Full))
-          .doc("Specifies the behavior of record field accesses.\n"
-               "\tLeftOnly: Any access to the left or right part of a dot "
-               "operator is viewed as an access to only the left part.\n"
-               "\tFull: Any access to the right part of the dot operator is "
-               "viewed as an access to the right part, but it is disambiguated "
-               "from other instances of the record using the left part. Any "
-               "access to the left part is viewed as an overlapping access to "
-               "any right parts contained within.\n"));
+      scl::Switch("format")
+          .argument("[csv|columnar|jsonl]",
+                    scl::enumParser<Output::Format>(settings.format)
+                        ->with("csv", Output::Format::CSV)
+                        ->with("columnar", Output::Format::Columnar)
+                        ->with("jsonl", Output::Format::JSONL))
+          .doc("The encoding of the metrics output.\n"
+               "\tcsv: One line per class, in the column order of "
+               "header.csv.\n"
+               "\tcolumnar: A compact binary file with the same columns, "
+               "stored column by column, for large result sets. The default "
+               "name ends in \".lcomcol\" instead of \".csv\". Convert it to "
+               "CSV with script/lcom_columnar.py.\n"
+               "\tjsonl: One JSON object per line and class, holding the "
+               "metrics along with the methods, attribute paths, accesses, "
+               "calls and LCOM4 components of the class. The default name "
+               "ends in \".jsonl\" instead of \".csv\".\n"));
   lcomArgs.insert(
-      scl::Switch("class-type")
-          .argument("[Default|Package|Function|Class|ProtectedObject|Namespace|All]",
-                    scl::enumParser<ClassType>(settings.classType)
-                        ->with("Package", ClassType::Package)
-                        ->with("Function", ClassType::Function)
-                        ->with("Class", ClassType::Class)
-                        ->with("ProtectedObject", ClassType::ProtectedObject)
-                        ->with("Namespace", ClassType::Namespace)
-                        ->with("Default", ClassType::Default)
-                        ->with("All", ClassType::All))
-          .doc(std::string(
-                   "The program unit to use as the LCOM class. \"All\" will "
-                   "run analysis on all predefined class types. Defaults to ") +
-               typeid(Class).name() + "."));
+      scl::Switch("shared-output")
+          .argument("filename", scl::anyParser(settings.sharedPath))
+          .doc("Append the CSV rows to this file instead of writing a CSV "
+               "file per source. Many processes may append to the same file "
+               "at once. Each process appends its rows as whole blocks under "
+               "a file lock, and the first one writes the header. Overrides "
+               "--lcom:csv-output."));
   lcomArgs.insert(
-      scl::Switch("filter-undefined-methods")
-          .intrinsicValue("true", scl::booleanParser(filterUndefinedMethods))
-          .doc("Filter out methods that are not defined."));
+      scl::Switch("quiet")
+          .intrinsicValue("true", scl::booleanParser(settings.quiet))
+          .doc("Do not print the metrics of each class to standard output. "
+               "They are still saved to the CSV output."));
   lcomArgs.insert(
-      scl::Switch("filter-ctors-dtors")
-          .intrinsicValue("true", scl::booleanParser(filterCtorsDtors))
-          .doc("Filter out constructors and destructors."));
-  scl::ParserResult cmdline = p.with(lcomArgs).parse(args).apply();
-
-  // Initialize the logger here.
-  // AixLog::Log::init<AixLog::SinkCout>(debug);
-  AixLog::Log::init<AixLog::SinkCallback>(
-      debug, [](const AixLog::Metadata& metadata, const std::string& message) {
-        std::cout << "[" << AixLog::to_string(metadata.severity) << "] "
-                  << message;
-        if (metadata.severity >= AixLog::Severity::warning) {
-          std::cout << " [" << metadata.function.file << ":"
-                    << metadata.function.line << "]";
-        }
-        if (metadata.severity >= AixLog::Severity::fatal) {
-          assert(false);
-        }
-        std::cout << std::endl;
-      });
+      scl::Switch("memory-columns")
+          .intrinsicValue("true", scl::booleanParser(settings.memoryColumns))
+          .doc("Append three columns to each CSV row: the approximate bytes "
+               "held by the class data, and the current and peak resident set "
+               "size of the process once its metrics were computed."));
+  lcomArgs.insert(
+      scl::Switch("outputs")
+          .argument("list", scl::anyParser(settings.outputs))
+          .doc("A comma-separated list of the outputs to write, all from a "
+               "single extraction.\n"
+               "\tmetrics: The metrics of each class, encoded as set by "
+               "--lcom:format.\n"
+               "\tcsv, columnar, jsonl: The metrics, in this format instead "
+               "of the one set by --lcom:format. Only one format can be "
+               "given.\n"
+               "\tdot: A DOT graph for each class, as written by "
+               "lcom-dot.out.\n"
+               "Defaults to \"metrics\"."));
+  lcomArgs.insert(
+      scl::Switch("dot-output")
+          .argument("filename", scl::anyParser(settings.dotPath))
+          .doc("Path to store dot output with --lcom:outputs dot. By default, "
+               "the file is stored in the same directory as the analyzed "
+               "file."));
+  lcomArgs.insert(
+      scl::Switch("dot-bundle")
+          .argument("filename", scl::anyParser(settings.bundlePath))
+          .doc("With --lcom:outputs dot, write every graph of the run into "
+               "this one file instead of a file per class, along with an "
+               "index of where each graph starts at \"<filename>.idx\". Read "
+               "it with script/lcom_dot_bundle.py. Overrides "
+               "--lcom:dot-output."));
+  Options::InsertDOTSwitches(lcomArgs);
+  std::vector<std::string> unparsedArgs =
+      Options::Parse(purpose, description, lcomArgs, args);
+  return std::make_tuple(unparsedArgs, settings);
+}
 
-  return std::make_tuple(cmdline.unparsedArgs(), settings);
+// Select the outputs named by --lcom:outputs. Returns false if the list is
+// not valid.
+bool SelectOutputs(Settings& settings) {
+  Output::Selection selection;
+  if (!Output::ParseOutputs(settings.outputs, selection)) return false;
+  settings.metricsOutput = selection.metrics;
+  settings.dotOutput = selection.dot;
+  if (selection.format) settings.format = *selection.format;
+  return true;
 }
 
 /*
@@ -141,18 +169,214 @@ std::string sourceLocation(const SgLocatedNode* n, const std::string& alt)
 bool specHasBody(const SgNode*) { return true; }
 bool specHasBody(const SgAdaPackageSpec* spec) { return si::Ada::getBodyDefinition(spec) != nullptr; }
 
+// Open the sink the metrics are written to. Returns null if there is no usable
+// output path.
+std::unique_ptr<Output::Sink> MakeMetricsSink(Settings& settings) {
+  std::unique_ptr<Output::Sink> sink;
+  if (!settings.sharedPath.empty()) {
+    if (!settings.csvPath.empty())
+      LOG(WARNING) << "--lcom:csv-output is ignored, as --lcom:shared-output "
+                      "was given."
+                   << std::endl;
+    LOG(DEBUG) << "Appending to " << settings.sharedPath << std::endl;
+    if (settings.format == Output::Format::Columnar) {
+      sink = std::make_unique<Output::ColumnarSink>(settings.sharedPath, true);
+    } else if (settings.format == Output::Format::JSONL) {
+      sink = std::make_unique<Output::JSONLSink>(settings.sharedPath, true);
+    } else {
+      sink = std::make_unique<Output::SharedCSVSink>(settings.sharedPath,
+                                                     settings.memoryColumns);
+    }
+  } else {
+    const boost::filesystem::path defaultPath =
+        Traverse::sourceFile.string() + Output::Extension(settings.format);
+    if (settings.csvPath.empty()) {
+      if (anonymous) {
+        LOG(ERROR)
+            << "The path was anonymized and thus cannot be used as an output "
+               "path. Please manually set a CSV path using the "
+               "--lcom::csv-output argument if you want to save the output."
+            << std::endl;
+        return nullptr;
+      }
+      settings.csvPath = defaultPath;
+    } else {
+      if (settings.csvPath.filename().empty()) {
+        settings.csvPath =
+            settings.csvPath.parent_path() / defaultPath.filename();
+      }
+    }
+    LOG(DEBUG) << "Outputting to " << settings.csvPath << std::endl;
+    if (settings.format == Output::Format::Columnar) {
+      sink = std::make_unique<Output::ColumnarSink>(settings.csvPath, false);
+    } else if (settings.format == Output::Format::JSONL) {
+      sink = std::make_unique<Output::JSONLSink>(settings.csvPath, false);
+    } else {
+      sink = std::make_unique<Output::CSVSink>(settings.csvPath);
+    }
+  }
+  return sink;
+}
+
+// A class along with the source details needed for output.
+// These are captured before the AST is released.
+template <typename C>
+struct ClassRecord {
+  LCOM::Class<C, Method, Attribute> LCOMClass;
+  std::string className;
+  boost::filesystem::path sourceFile;
+  // true, iff package spec & body were available or !package
+  bool hasBody;
+  // Only captured for sinks that need it. The LCOM4 components are left for
+  // ProcessLCOM, which moves the detail into its row.
+  Output::Detail detail;
+};
+
+// Capture the methods, attributes and edges of a class, while the AST is still
+// available to name them.
+template <typename C>
+Output::Detail GetDetail(const LCOM::Class<C, Method, Attribute>& LCOMClass) {
+  Output::Detail detail;
+  std::map<Method, std::size_t> methods;
+  for (const auto& method : LCOMClass.methods) {
+    methods.emplace(method.GetId(), detail.methods.size());
+    // Named as in the DOT output.
+    detail.methods.push_back(DOT::MethodName(method.GetId()));
+  }
+  std::map<Attribute, std::size_t> attributes;
+  for (const auto& method : LCOMClass.methods) {
+    const std::size_t caller = methods.at(method.GetId());
+    for (const auto& attribute : method.attributes) {
+      const Attribute& id = attribute.GetId();
+      const auto it = attributes.emplace(id, detail.attributes.size());
+      if (it.second) {
+        std::vector<std::string> path;
+        for (auto a = id.cbegin(); a != id.cend(); ++a) {
+          path.push_back(NPrint::source_name(*a));
+        }
+        detail.attributes.push_back(std::move(path));
+      }
+      detail.accesses.emplace_back(caller, it.first->second);
+    }
+    for (const auto& calledMethod : method.calledMethods) {
+      const auto callee = methods.find(calledMethod.GetId());
+      if (callee != methods.end())
+        detail.calls.emplace_back(caller, callee->second);
+    }
+  }
+  return detail;
+}
+
+// Compute the LCOM metrics of each class and write them to the sink.
+template <typename C>
+void ProcessLCOM(std::vector<ClassRecord<C>>& records, const Settings& settings,
+                 Output::Sink& sink) {
+  Output::Row row;
+  row.classType = typeid(C).name();
+  row.dotBehavior = [&]() {
+    std::stringstream ss;
+    ss << dotBehavior;
+    return ss.str();
+  }();
+  for (auto& record : records) {
+    const auto& LCOMClass = record.LCOMClass;
+    const std::string& className = record.className;
+    const std::string& classType = row.classType;
+
+    // Get the LCOM measurements.
+    row.LCOM1 = [&]() {
+      Profile::Scope scope("LCOM1", classType, className);
+      return LCOM::LCOM1(LCOMClass, &row.data1);
+    }();
+    row.LCOM2 = [&]() {
+      Profile::Scope scope("LCOM2", classType, className);
+      return LCOM::LCOM2(LCOMClass);
+    }();
+    row.LCOM3 = [&]() {
+      Profile::Scope scope("LCOM3", classType, className);
+      return LCOM::LCOM3(LCOMClass);
+    }();
+    row.LCOM4 = [&]() {
+      Profile::Scope scope("LCOM4", classType, className);
+      return LCOM::LCOM4(LCOMClass);
+    }();
+    row.LCOM5 = [&]() {
+      Profile::Scope scope("LCOM5", classType, className);
+      return LCOM::LCOM5(LCOMClass, &row.data5);
+    }();
+    if (!settings.quiet) {
+      // Log messages share standard output, so write everything logged so far
+      // first, and flush the block before anything else is logged.
+      AsyncLog::Sync();
+      std::cout << "Class: " << className << '\n'
+                << "LCOM1: " << row.LCOM1 << '\n'
+                << "LCOM2: " << row.LCOM2 << '\n'
+                << "LCOM3: " << row.LCOM3 << '\n'
+                << "LCOM4: " << row.LCOM4 << '\n'
+                << "LCOM5: " << row.LCOM5 << '\n'
+                << "LCOM1Norm: " << row.LCOM1Norm() << '\n'
+                << "LCOM2Norm: " << row.LCOM2Norm() << '\n'
+                << "LCOM3Norm: " << row.LCOM3Norm() << '\n'
+                << "LCOM4Norm: " << row.LCOM4Norm() << '\n';
+      AsyncLog::Sync();
+    }
+
+    // PP: reporting LCOM on a spec w/o function bodies may not be very meaningful.
+    if (!record.hasBody) continue;
+
+    row.sourceFile = record.sourceFile;
+    row.className = className;
+    row.hasMemory = settings.memoryColumns;
+    if (settings.memoryColumns) {
+      const Profile::RSS rss = Profile::ReadRSS();
+      row.approxBytes = LCOM::ApproxBytes(LCOMClass);
+      row.rssBytes = rss.current;
+      row.peakRssBytes = rss.peak;
+    }
+    if (sink.NeedsDetail()) {
+      row.detail = std::move(record.detail);
+      const auto components = LCOM::LCOM4Components(LCOMClass);
+      row.detail.components.clear();
+      for (const auto& method : LCOMClass.methods) {
+        row.detail.components.push_back(components.at(method.GetId()));
+      }
+    }
+    sink.Write(row);
+  }
+}
+
+// Metric computation for a single class type. It only depends on extracted
+// data, so it can run after the AST has been released.
+using LCOMJob = std::function<void(Output::Sink&)>;
+
+// Returns the metrics sink, creating it on first use. If it cannot be created,
+// a NullSink is returned instead, so the metrics are still printed.
+using SinkGetter = std::function<Output::Sink*()>;
+
 template <typename C>
-std::string ProcessLCOM(SgProject* project) {
-  std::stringstream ss;
+LCOMJob ExtractLCOM(SgProject* project, const Settings& settings,
+                    DOT::Sink* dotSink, const SinkGetter& getSink) {
+  auto records = std::make_shared<std::vector<ClassRecord<C>>>();
   const std::vector<LCOM::Class<C, Method, Attribute>> LCOMInput =
       Traverse::GetClassData<C>(project);
-      
-  // Compute LCOM metrics for each class.
+  // Graphs name their methods through the AST, so write them right away.
+  if (dotSink) DOT::GenerateLCOMGraphs<C>(LCOMInput, *dotSink);
+  if (!settings.metricsOutput) {
+    Traverse::IA<C>::Clear();
+    return [](Output::Sink&) {};
+  }
+
+  // The detail of every class would take about as much memory as the node
+  // data, so when it is needed, each class is written as soon as it has been
+  // captured instead, and only one class is held at a time.
+  const bool streamed = settings.format == Output::Format::JSONL;
+  Output::Sink* sink = streamed ? getSink() : nullptr;
+
+  // Capture everything that requires the AST.
   for (const auto& LCOMClass : LCOMInput) {
     std::string className = "null";
     boost::filesystem::path sourceFile = Traverse::sourceFile;
 
-    // true, iff package spec & body were available or !package
     bool hasBody = true;
     if (C elem = is<C>(LCOMClass.GetId())) {
       Traverse::Class<C>& classObj =
@@ -163,47 +387,21 @@ std::string ProcessLCOM(SgProject* project) {
       sourceFile = classObj.sourceFile;
       hasBody = specHasBody(elem);
     }
-    std::cout << "Class: " << className << std::endl;
-    LCOM::LCOM1Data data1;
-    LCOM::LCOM5Data data5;
-    // Get the LCOM measurements.
-    const std::size_t lcom1 = LCOM::LCOM1(LCOMClass, &data1);
-    std::cout << "LCOM1: " << lcom1 << std::endl;
-    const std::size_t lcom2 = LCOM::LCOM2(LCOMClass);
-    std::cout << "LCOM2: " << lcom2 << std::endl;
-    const std::size_t lcom3 = LCOM::LCOM3(LCOMClass);
-    std::cout << "LCOM3: " << lcom3 << std::endl;
-    const std::size_t lcom4 = LCOM::LCOM4(LCOMClass);
-    std::cout << "LCOM4: " << lcom4 << std::endl;
-    const double lcom5 = LCOM::LCOM5(LCOMClass, &data5);
-    std::cout << "LCOM5: " << lcom5 << std::endl;
-    // Normalized.
-    std::cout << "LCOM1Norm: " << (double)lcom1 / (double)data1.totalPairs
-              << std::endl;
-    std::cout << "LCOM2Norm: " << (double)lcom2 / (double)data1.totalPairs
-              << std::endl;
-    std::cout << "LCOM3Norm: " << (double)lcom3 / (double)data5.k << std::endl;
-    // NOTE: Normalized LCOM4 is basically YALCOM without special 0 and 1 cases.
-    // https://www.tusharma.in/yalcom-yet-another-lcom-metric.html
-    std::cout << "LCOM4Norm: " << (double)lcom4 / (double)data5.k << std::endl;
-
-    // PP: reporting LCOM on a spec w/o function bodies may not be very meaningful.
-    if (!hasBody) continue;
-
-    // Generate a line of CSV.
-    ss << sourceFile << ",\"" << className << "\",\"" << typeid(C).name()
-       << "\",\"" << dotBehavior << "\",";
-    ss << lcom1 << "," << lcom2 << "," << lcom3 << "," << lcom4 << "," << lcom5
-       << ",";
-    ss << data1.sharedPairs << "," << data1.unsharedPairs << ","
-       << data1.totalPairs << ",";
-    ss << data5.a << "," << data5.l << "," << data5.k << ",";
-    ss << (double)lcom1 / (double)data1.totalPairs << ",";
-    ss << (double)lcom2 / (double)data1.totalPairs << ",";
-    ss << (double)lcom3 / (double)data5.k << ",";
-    ss << (double)lcom4 / (double)data5.k << "," << std::endl;
+    Output::Detail detail;
+    if (streamed && sink->NeedsDetail()) detail = GetDetail(LCOMClass);
+    records->push_back(ClassRecord<C>{LCOMClass, className, sourceFile,
+                                      hasBody, std::move(detail)});
+    if (streamed) {
+      ProcessLCOM<C>(*records, settings, *sink);
+      records->clear();
+    }
   }
-  return ss.str();
+  // The node data is no longer needed.
+  Traverse::IA<C>::Clear();
+
+  return [records, settings](Output::Sink& sink) {
+    ProcessLCOM<C>(*records, settings, sink);
+  };
 }
 
 int main(int argc, char* argv[]) {
@@ -212,6 +410,7 @@ int main(int argc, char* argv[]) {
   Settings settings;
   std::tie(cmdLineArgs, settings) =
       parseArgs(std::move(cmdLineArgs), settings, argc, argv);
+  if (!SelectOutputs(settings)) return -1;
   if (!anonymous) {
     LOG(DEBUG) << "Remaining args:";
     for (auto i = cmdLineArgs.begin(); i != cmdLineArgs.end(); ++i) {
@@ -232,66 +431,105 @@ int main(int argc, char* argv[]) {
   LOG(INFO) << "Running command: " << cmdStream.str() << std::endl;
 
   SgProject* project = Traverse::GetProject(cmdLineArgs);
-  // CSV line output.
-  std::stringstream ss;
   LOG(DEBUG) << "Running analysis for class type: " << settings.classType
              << std::endl;
+  Profile::SetInfo("classType", settings.classType);
+  Profile::SetInfo("dotBehavior", dotBehavior);
+  Profile::SetInfo("extraction", extraction);
+  std::unique_ptr<DOT::Sink> dotSink;
+  if (settings.dotOutput) {
+    dotSink = DOT::MakeSink(settings.dotPath, settings.bundlePath);
+  }
+  // The default output path is only known once the source file has been
+  // found, so the metrics sink is created on first use.
+  std::unique_ptr<Output::Sink> sink;
+  bool sinkFailed = false;
+  const SinkGetter getSink = [&]() -> Output::Sink* {
+    if (!sink) {
+      sink = MakeMetricsSink(settings);
+      if (!sink) {
+        sinkFailed = true;
+        sink = std::make_unique<Output::NullSink>();
+      }
+    }
+    return sink.get();
+  };
+  std::vector<LCOMJob> jobs;
   switch (settings.classType) {
     case ClassType::Package:
-      ss << ProcessLCOM<SgAdaPackageSpec*>(project);
+      jobs.push_back(ExtractLCOM<SgAdaPackageSpec*>(
+          project, settings, dotSink.get(), getSink));
       break;
     case ClassType::Function:
-      ss << ProcessLCOM<SgFunctionDeclaration*>(project);
+      jobs.push_back(ExtractLCOM<SgFunctionDeclaration*>(
+          project, settings, dotSink.get(), getSink));
       break;
     case ClassType::Class:
-      ss << ProcessLCOM<SgClassDeclaration*>(project);
+      jobs.push_back(ExtractLCOM<SgClassDeclaration*>(
+          project, settings, dotSink.get(), getSink));
       break;
     case ClassType::ProtectedObject:
-      ss << ProcessLCOM<SgAdaProtectedSpec*>(project);
+      jobs.push_back(ExtractLCOM<SgAdaProtectedSpec*>(
+          project, settings, dotSink.get(), getSink));
       break;
     case ClassType::Namespace:
-      ss << ProcessLCOM<SgNamespaceDeclarationStatement*>(project);
+      jobs.push_back(ExtractLCOM<SgNamespaceDeclarationStatement*>(
+          project, settings, dotSink.get(), getSink));
       break;
     case ClassType::Default:
       LOG(INFO) << "No/invalid class type specified. Running analysis on "
                    "default type, "
                 << typeid(Class).name() << "." << std::endl;
-      ss << ProcessLCOM<Class>(project);
+      jobs.push_back(
+          ExtractLCOM<Class>(project, settings, dotSink.get(), getSink));
       break;
     case ClassType::All:
-      ss << ProcessLCOM<SgAdaPackageSpec*>(project);
-      ss << ProcessLCOM<SgFunctionDeclaration*>(project);
-      ss << ProcessLCOM<SgClassDeclaration*>(project);
-      ss << ProcessLCOM<SgAdaProtectedSpec*>(project);
-      ss << ProcessLCOM<SgNamespaceDeclarationStatement*>(project);
+      jobs.push_back(ExtractLCOM<SgAdaPackageSpec*>(
+          project, settings, dotSink.get(), getSink));
+      jobs.push_back(ExtractLCOM<SgFunctionDeclaration*>(
+          project, settings, dotSink.get(), getSink));
+      jobs.push_back(ExtractLCOM<SgClassDeclaration*>(
+          project, settings, dotSink.get(), getSink));
+      jobs.push_back(ExtractLCOM<SgAdaProtectedSpec*>(
+          project, settings, dotSink.get(), getSink));
+      jobs.push_back(ExtractLCOM<SgNamespaceDeclarationStatement*>(
+          project, settings, dotSink.get(), getSink));
   }
 
-  // Output the string to file.
-  const boost::filesystem::path defaultPath =
-      Traverse::sourceFile.string() + ".csv";
-  if (settings.csvPath.empty()) {
-    if (anonymous) {
-      LOG(ERROR)
-          << "The path was anonymized and thus cannot be used as an output "
-             "path. Please manually set a CSV path using the "
-             "--lcom::csv-output argument if you want to save the output."
-          << std::endl;
-      return -1;
-    }
-    settings.csvPath = defaultPath;
-  } else {
-    if (settings.csvPath.filename().empty()) {
-      settings.csvPath =
-          settings.csvPath.parent_path() / defaultPath.filename();
-    }
+  // The exit status, which is non-zero if an output could not be saved.
+  int status = 0;
+  if (dotSink && !dotSink->Close()) {
+    LOG(ERROR) << "Unable to save the DOT graphs." << std::endl;
+    status = -1;
+  }
+
+  // All class data has been extracted. Free the AST before computing metrics
+  // to reduce peak memory.
+  Traverse::ReleaseProject(project);
+  if (!settings.metricsOutput) {
+    Profile::Write();
+    Trace::Write();
+    Stats::Print();
+    return status;
   }
-  std::ofstream of(settings.csvPath.string());
-  if (of.is_open()) {
-    LOG(DEBUG) << "Outputting " << ss.str() << " to " << settings.csvPath
-               << std::endl;
-    of << ss.str();
+
+  // Without a sink the metrics are still printed, but the run fails.
+  getSink();
+  if (sinkFailed) status = -1;
+  // Each row is written as soon as its class is processed.
+  for (const auto& job : jobs) {
+    job(*sink);
+  }
+  {
+    Profile::Scope scope("CSVOutput");
+    if (!sink->Close()) {
+      LOG(ERROR) << "Unable to save the metrics output." << std::endl;
+      status = -1;
+    }
   }
-  of.close();
 
-  return 0;
+  Profile::Write();
+  Trace::Write();
+  Stats::Print();
+  return status;
 }